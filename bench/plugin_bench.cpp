@@ -0,0 +1,593 @@
+// Headless benchmark host: renders the same input through the bare ElastikaEngine and through the
+// built plugin, at several block sizes and automation densities, and reports ns/sample for each.
+// The difference is what the plugin wrapper (parameter handling, event translation, bus layout)
+// costs on top of the physics. The VST3 build is hosted through JUCE, the CLAP build directly
+// (JUCE can't host CLAP), so that its parameter events go through the wrapper's own translation.
+//
+// It also times creating instances (building the engine against copying its shared rest state),
+// and the convolution that replaces the mesh in convolution mode against the mesh itself.
+//
+// Usage: elastika-bench [--vst3 <path to Elastika.vst3>] [--clap <path to Elastika.clap>]
+//                       [--seconds <audio seconds per run>]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "clap/clap.h"
+#include "elastika_engine.hpp"
+#include "juce_audio_processors/juce_audio_processors.h"
+#include "juce_dsp/juce_dsp.h"
+
+namespace
+{
+
+constexpr double sample_rate = 48000.0;
+constexpr int block_sizes[] = {32, 64, 128, 256, 512, 1024};
+// A large session's worth of instances.
+constexpr int creation_count = 40;
+// Impulse response lengths for convolution mode: a short room and the longest it accepts.
+constexpr double ir_seconds[] = {0.5, 2.0};
+
+// Parameter changes per block: none, one, or one every 32 samples (the event resolution the plugin
+// asks hosts for). Changes land at evenly spaced sample offsets within the block.
+struct Density
+{
+    const char *name;
+    int changes_per_block(int block_size) const
+    {
+        return per_32_samples ? std::max(1, block_size / 32) : changes;
+    }
+    int changes;
+    bool per_32_samples;
+};
+
+constexpr Density densities[] = {{"none", 0, false}, {"1/block", 1, false}, {"1/32smp", 0, true}};
+
+// Slowly sweeping automation value in [0.3, 0.7].
+float automation_value(int block_index, int change)
+{
+    return 0.5f + 0.2f * std::sin(0.01f * static_cast<float>(block_index) + 0.1f * change);
+}
+
+juce::AudioBuffer<float> make_input(double seconds)
+{
+    juce::AudioBuffer<float> input(2, static_cast<int>(seconds * sample_rate));
+    juce::Random random(1234);
+    for (int c = 0; c < input.getNumChannels(); ++c)
+    {
+        for (int s = 0; s < input.getNumSamples(); ++s)
+        {
+            input.setSample(c, s, 0.25f * (random.nextFloat() * 2.f - 1.f));
+        }
+    }
+    return input;
+}
+
+double ns_per_sample(juce::int64 ticks, int samples)
+{
+    const double seconds = static_cast<double>(ticks) /
+                           static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+    return seconds * 1e9 / samples;
+}
+
+// Keeps the compiler from discarding the rendered output.
+volatile float sink = 0.f;
+
+double bench_engine(const juce::AudioBuffer<float> &input, int block_size, int changes)
+{
+    Sapphire::ElastikaEngine engine;
+    const float *in_l = input.getReadPointer(0);
+    const float *in_r = input.getReadPointer(1);
+    const int blocks = input.getNumSamples() / block_size;
+    const int spacing = block_size / std::max(1, changes);
+    float sum = 0.f;
+
+    const juce::int64 start = juce::Time::getHighResolutionTicks();
+    for (int b = 0; b < blocks; ++b)
+    {
+        for (int offset = 0; offset < block_size; ++offset)
+        {
+            // The same change at the same offset as the plugin gets it.
+            if (offset % spacing == 0 && offset / spacing < changes)
+            {
+                engine.setFriction(automation_value(b, offset / spacing));
+            }
+            const int s = b * block_size + offset;
+            float l, r;
+            engine.process(static_cast<float>(sample_rate), in_l[s], in_r[s], l, r);
+            sum += l + r;
+        }
+    }
+    const juce::int64 elapsed = juce::Time::getHighResolutionTicks() - start;
+    sink = sum;
+    return ns_per_sample(elapsed, blocks * block_size);
+}
+
+double bench_plugin(juce::AudioPluginInstance &plugin, const juce::AudioBuffer<float> &input,
+                    int block_size, int changes)
+{
+    plugin.releaseResources();
+    plugin.setRateAndBufferSizeDetails(sample_rate, block_size);
+    plugin.prepareToPlay(sample_rate, block_size);
+
+    // Friction is the first parameter; any will do, they all go through the same path.
+    juce::AudioProcessorParameter *param = plugin.getParameters()[0];
+    const int channels =
+        std::max({2, plugin.getTotalNumInputChannels(), plugin.getTotalNumOutputChannels()});
+    juce::AudioBuffer<float> buffer(channels, block_size);
+    juce::MidiBuffer midi;
+    const int blocks = input.getNumSamples() / block_size;
+    float sum = 0.f;
+
+    // JUCE's VST3 hosting passes only the last value of each parameter per processBlock, at
+    // offset 0. To deliver every change at its own sample, the block is processed as one
+    // sub-block per change, the way a host splits its blocks for sample-accurate automation.
+    const int sub_blocks = std::max(1, changes);
+    const int spacing = block_size / sub_blocks;
+    std::vector<float *> sub_channels(static_cast<size_t>(channels));
+    juce::AudioBuffer<float> sub_buffer;
+
+    const juce::int64 start = juce::Time::getHighResolutionTicks();
+    for (int b = 0; b < blocks; ++b)
+    {
+        buffer.copyFrom(0, 0, input, 0, b * block_size, block_size);
+        buffer.copyFrom(1, 0, input, 1, b * block_size, block_size);
+        for (int sub = 0; sub < sub_blocks; ++sub)
+        {
+            const int offset = sub * spacing;
+            const int length = sub == sub_blocks - 1 ? block_size - offset : spacing;
+            if (sub < changes)
+            {
+                param->setValue(automation_value(b, sub));
+            }
+            for (int c = 0; c < channels; ++c)
+            {
+                sub_channels[static_cast<size_t>(c)] = buffer.getWritePointer(c, offset);
+            }
+            sub_buffer.setDataToReferTo(sub_channels.data(), channels, length);
+            plugin.processBlock(sub_buffer, midi);
+        }
+        sum += buffer.getSample(0, block_size - 1);
+    }
+    const juce::int64 elapsed = juce::Time::getHighResolutionTicks() - start;
+    sink = sum;
+    plugin.releaseResources();
+    return ns_per_sample(elapsed, blocks * block_size);
+}
+
+// Convolution mode as the plugin runs it: two zero-latency stereo convolvers, one per input
+// channel, so four paths. The response is decaying noise, which costs the same as a captured one.
+double bench_convolution(const juce::AudioBuffer<float> &input, int block_size, double seconds)
+{
+    using juce::dsp::Convolution;
+    const int length = static_cast<int>(seconds * sample_rate);
+    juce::Random random(5678);
+    Convolution convolvers[2];
+    for (Convolution &convolver : convolvers)
+    {
+        juce::AudioBuffer<float> response(2, length);
+        for (int c = 0; c < 2; ++c)
+        {
+            for (int s = 0; s < length; ++s)
+            {
+                const float decay = std::exp(-6.9f * static_cast<float>(s) / length);
+                response.setSample(c, s, decay * (random.nextFloat() * 2.f - 1.f));
+            }
+        }
+        convolver.prepare({sample_rate, static_cast<juce::uint32>(block_size), 2});
+        convolver.loadImpulseResponse(std::move(response), sample_rate, Convolution::Stereo::yes,
+                                      Convolution::Trim::no, Convolution::Normalise::no);
+    }
+
+    juce::AudioBuffer<float> from_left(2, block_size);
+    juce::AudioBuffer<float> from_right(2, block_size);
+    const auto run = [&](int b) {
+        for (int c = 0; c < 2; ++c)
+        {
+            from_left.copyFrom(c, 0, input, 0, b * block_size, block_size);
+            from_right.copyFrom(c, 0, input, 1, b * block_size, block_size);
+        }
+        juce::dsp::AudioBlock<float> left_block(from_left);
+        juce::dsp::AudioBlock<float> right_block(from_right);
+        convolvers[0].process(juce::dsp::ProcessContextReplacing<float>(left_block));
+        convolvers[1].process(juce::dsp::ProcessContextReplacing<float>(right_block));
+        return from_left.getSample(0, block_size - 1) + from_right.getSample(1, block_size - 1);
+    };
+
+    // The response is installed on the audio thread once the background load is done, then
+    // crossfaded in; time only what runs after that.
+    const int blocks = input.getNumSamples() / block_size;
+    const int crossfade_blocks = static_cast<int>(0.1 * sample_rate) / block_size + 1;
+    while (convolvers[0].getCurrentIRSize() != length || convolvers[1].getCurrentIRSize() != length)
+    {
+        run(0);
+        juce::Thread::sleep(1);
+    }
+    for (int b = 0; b < crossfade_blocks; ++b)
+    {
+        run(b % blocks);
+    }
+
+    float sum = 0.f;
+    const juce::int64 start = juce::Time::getHighResolutionTicks();
+    for (int b = 0; b < blocks; ++b)
+    {
+        sum += run(b);
+    }
+    const juce::int64 elapsed = juce::Time::getHighResolutionTicks() - start;
+    sink = sum;
+    return ns_per_sample(elapsed, blocks * block_size);
+}
+
+void print_convolution_table(const juce::AudioBuffer<float> &input)
+{
+    std::printf("Convolution mode against the mesh, ns/sample\n");
+    std::printf("%6s %10s", "block", "mesh");
+    for (double seconds : ir_seconds)
+    {
+        std::printf("    conv %3.1fs", seconds);
+    }
+    std::printf("\n");
+    for (int block_size : block_sizes)
+    {
+        std::printf("%6d %10.1f", block_size, bench_engine(input, block_size, 0));
+        for (double seconds : ir_seconds)
+        {
+            std::printf(" %12.1f", bench_convolution(input, block_size, seconds));
+        }
+        std::printf("\n");
+    }
+    std::printf("\n");
+}
+
+// A CLAP plugin file, opened by hand: its entry point and plugin factory. Instances are of the
+// first plugin in the file, and must be destroyed before it is.
+class ClapLibrary
+{
+  public:
+    // Returns nullptr, having said why, if there is no usable CLAP plugin at path.
+    static std::unique_ptr<ClapLibrary> open(const juce::String &path)
+    {
+        auto library = std::make_unique<ClapLibrary>();
+        if (!library->library_.open(path))
+        {
+            std::fprintf(stderr, "Couldn't load %s\n", path.toRawUTF8());
+            return nullptr;
+        }
+        const auto *entry =
+            static_cast<const clap_plugin_entry_t *>(library->library_.getFunction("clap_entry"));
+        if (!entry || !entry->init(path.toRawUTF8()))
+        {
+            std::fprintf(stderr, "No CLAP entry point in %s\n", path.toRawUTF8());
+            return nullptr;
+        }
+        library->entry_ = entry;
+        library->factory_ =
+            static_cast<const clap_plugin_factory_t *>(entry->get_factory(CLAP_PLUGIN_FACTORY_ID));
+        if (!library->factory_ || library->factory_->get_plugin_count(library->factory_) == 0)
+        {
+            std::fprintf(stderr, "No CLAP plugin in %s\n", path.toRawUTF8());
+            return nullptr;
+        }
+        return library;
+    }
+
+    ~ClapLibrary()
+    {
+        if (entry_)
+        {
+            entry_->deinit();
+        }
+    }
+
+    // An initialised instance, or nullptr.
+    const clap_plugin_t *create() const
+    {
+        const clap_plugin_descriptor_t *descriptor = factory_->get_plugin_descriptor(factory_, 0);
+        const clap_plugin_t *plugin = factory_->create_plugin(factory_, &host_, descriptor->id);
+        if (plugin && !plugin->init(plugin))
+        {
+            plugin->destroy(plugin);
+            return nullptr;
+        }
+        return plugin;
+    }
+
+  private:
+    // The host offers no extensions and ignores the plugin's requests: nothing in the benchmark
+    // needs a restart, a callback or more processing than it already gets.
+    static clap_host_t make_host()
+    {
+        clap_host_t host{};
+        host.clap_version = CLAP_VERSION;
+        host.name = "elastika-bench";
+        host.vendor = "Sapphire";
+        host.url = "";
+        host.version = "1.0";
+        host.get_extension = [](const clap_host_t *, const char *) -> const void * {
+            return nullptr;
+        };
+        host.request_restart = [](const clap_host_t *) {};
+        host.request_process = [](const clap_host_t *) {};
+        host.request_callback = [](const clap_host_t *) {};
+        return host;
+    }
+
+    const clap_host_t host_ = make_host();
+    juce::DynamicLibrary library_;
+    const clap_plugin_entry_t *entry_ = nullptr;
+    const clap_plugin_factory_t *factory_ = nullptr;
+};
+
+// The CLAP build, given each change as a CLAP_EVENT_PARAM_VALUE at its own sample offset in one
+// process call per block. The wrapper splits the block at its 32-sample event resolution and sets
+// the JUCE parameter, so this measures the event translation the format really does.
+double bench_clap(const ClapLibrary &library, const juce::AudioBuffer<float> &input, int block_size,
+                  int changes)
+{
+    const clap_plugin_t *plugin = library.create();
+    if (!plugin)
+    {
+        return 0;
+    }
+    // Friction is the first parameter, as for VST3.
+    const auto *params =
+        static_cast<const clap_plugin_params_t *>(plugin->get_extension(plugin, CLAP_EXT_PARAMS));
+    clap_param_info_t info{};
+    params->get_info(plugin, 0, &info);
+    plugin->activate(plugin, sample_rate, 1, static_cast<uint32_t>(block_size));
+    plugin->start_processing(plugin);
+
+    juce::AudioBuffer<float> in_buffer(2, block_size);
+    juce::AudioBuffer<float> out_buffer(2, block_size);
+    clap_audio_buffer_t audio_in{};
+    audio_in.data32 = in_buffer.getArrayOfWritePointers();
+    audio_in.channel_count = 2;
+    clap_audio_buffer_t audio_out{};
+    audio_out.data32 = out_buffer.getArrayOfWritePointers();
+    audio_out.channel_count = 2;
+
+    std::vector<clap_event_param_value_t> events;
+    events.reserve(static_cast<size_t>(changes));
+    const clap_input_events_t in_events{
+        &events,
+        [](const clap_input_events_t *list) {
+            return static_cast<uint32_t>(
+                static_cast<const std::vector<clap_event_param_value_t> *>(list->ctx)->size());
+        },
+        [](const clap_input_events_t *list, uint32_t index) {
+            const auto &queued =
+                *static_cast<const std::vector<clap_event_param_value_t> *>(list->ctx);
+            return &queued[index].header;
+        }};
+    const clap_output_events_t out_events{
+        nullptr, [](const clap_output_events_t *, const clap_event_header_t *) { return true; }};
+
+    clap_process_t process{};
+    process.frames_count = static_cast<uint32_t>(block_size);
+    process.audio_inputs = &audio_in;
+    process.audio_outputs = &audio_out;
+    process.audio_inputs_count = 1;
+    process.audio_outputs_count = 1;
+    process.in_events = &in_events;
+    process.out_events = &out_events;
+
+    const int blocks = input.getNumSamples() / block_size;
+    const int spacing = block_size / std::max(1, changes);
+    float sum = 0.f;
+
+    const juce::int64 start = juce::Time::getHighResolutionTicks();
+    for (int b = 0; b < blocks; ++b)
+    {
+        in_buffer.copyFrom(0, 0, input, 0, b * block_size, block_size);
+        in_buffer.copyFrom(1, 0, input, 1, b * block_size, block_size);
+        events.clear();
+        for (int change = 0; change < changes; ++change)
+        {
+            clap_event_param_value_t event{};
+            event.header.size = sizeof(event);
+            event.header.time = static_cast<uint32_t>(change * spacing);
+            event.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+            event.header.type = CLAP_EVENT_PARAM_VALUE;
+            event.param_id = info.id;
+            event.cookie = info.cookie;
+            event.note_id = -1;
+            event.port_index = -1;
+            event.channel = -1;
+            event.key = -1;
+            event.value = automation_value(b, change);
+            events.push_back(event);
+        }
+        process.steady_time = static_cast<int64_t>(b) * block_size;
+        plugin->process(plugin, &process);
+        sum += out_buffer.getSample(0, block_size - 1);
+    }
+    const juce::int64 elapsed = juce::Time::getHighResolutionTicks() - start;
+    sink = sum;
+
+    plugin->stop_processing(plugin);
+    plugin->deactivate(plugin);
+    plugin->destroy(plugin);
+    return ns_per_sample(elapsed, blocks * block_size);
+}
+
+std::unique_ptr<juce::PluginDescription> find_plugin(juce::AudioPluginFormat &format,
+                                                     const juce::String &path)
+{
+    juce::OwnedArray<juce::PluginDescription> found;
+    format.findAllTypesForFile(found, path);
+    if (found.isEmpty())
+    {
+        std::fprintf(stderr, "No plugin found at %s\n", path.toRawUTF8());
+        return nullptr;
+    }
+    return std::make_unique<juce::PluginDescription>(*found[0]);
+}
+
+std::unique_ptr<juce::AudioPluginInstance> create_plugin(juce::AudioPluginFormat &format,
+                                                         const juce::PluginDescription &description)
+{
+    juce::String error;
+    auto plugin = format.createInstanceFromDescription(description, sample_rate, block_sizes[0],
+                                                       error);
+    if (!plugin)
+    {
+        std::fprintf(stderr, "Couldn't load %s: %s\n", description.fileOrIdentifier.toRawUTF8(),
+                     error.toRawUTF8());
+    }
+    return plugin;
+}
+
+double ms_each(juce::int64 ticks, int count)
+{
+    return static_cast<double>(ticks) * 1e3 /
+           static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()) / count;
+}
+
+void print_creation_row(const char *name, double ms)
+{
+    if (ms > 0)
+    {
+        std::printf("%-30s %8.3f\n", name, ms);
+    }
+    else
+    {
+        std::printf("%-30s %8s\n", name, "-");
+    }
+}
+
+// How long creating an instance takes, as in a session that loads many of them: building an
+// engine from scratch, copying the shared rest-state prototype as the plugin does, and creating
+// each hosted build while another instance (holding the prototype) is alive.
+void bench_creation(juce::AudioPluginFormat &format, const juce::PluginDescription *description,
+                    const ClapLibrary *clap)
+{
+    std::vector<std::unique_ptr<Sapphire::ElastikaEngine>> engines;
+    engines.reserve(creation_count);
+    juce::int64 start = juce::Time::getHighResolutionTicks();
+    for (int i = 0; i < creation_count; ++i)
+    {
+        engines.push_back(std::make_unique<Sapphire::ElastikaEngine>());
+    }
+    const double built = ms_each(juce::Time::getHighResolutionTicks() - start, creation_count);
+
+    const Sapphire::ElastikaEngine prototype;
+    engines.clear();
+    start = juce::Time::getHighResolutionTicks();
+    for (int i = 0; i < creation_count; ++i)
+    {
+        engines.push_back(std::make_unique<Sapphire::ElastikaEngine>(prototype));
+    }
+    const double copied = ms_each(juce::Time::getHighResolutionTicks() - start, creation_count);
+
+    double vst3 = 0;
+    if (description)
+    {
+        std::vector<std::unique_ptr<juce::AudioPluginInstance>> plugins;
+        start = juce::Time::getHighResolutionTicks();
+        for (int i = 0; i < creation_count; ++i)
+        {
+            plugins.push_back(create_plugin(format, *description));
+        }
+        vst3 = ms_each(juce::Time::getHighResolutionTicks() - start, creation_count);
+    }
+
+    double clap_ms = 0;
+    if (clap)
+    {
+        std::vector<const clap_plugin_t *> plugins;
+        start = juce::Time::getHighResolutionTicks();
+        for (int i = 0; i < creation_count; ++i)
+        {
+            plugins.push_back(clap->create());
+        }
+        clap_ms = ms_each(juce::Time::getHighResolutionTicks() - start, creation_count);
+        for (const clap_plugin_t *plugin : plugins)
+        {
+            if (plugin)
+            {
+                plugin->destroy(plugin);
+            }
+        }
+    }
+
+    std::printf("Creating %d instances, ms each\n", creation_count);
+    print_creation_row("engine built from scratch", built);
+    print_creation_row("engine copied from prototype", copied);
+    print_creation_row("vst3 instance", vst3);
+    print_creation_row("clap instance", clap_ms);
+    std::printf("\n");
+}
+
+// A timing, or "-" where the build wasn't measured; with its overhead over the engine alone.
+void print_timing(double ns, double engine)
+{
+    if (ns > 0)
+    {
+        std::printf(" %10.1f %9.1f%%", ns, 100.0 * (ns - engine) / engine);
+    }
+    else
+    {
+        std::printf(" %10s %10s", "-", "-");
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juce_init;
+
+    juce::String vst3_path = ELASTIKA_VST3_PATH;
+    juce::String clap_path = ELASTIKA_CLAP_PATH;
+    double seconds = 10.0;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const juce::String flag = argv[i];
+        if (flag == "--vst3")
+        {
+            vst3_path = argv[i + 1];
+        }
+        else if (flag == "--clap")
+        {
+            clap_path = argv[i + 1];
+        }
+        else if (flag == "--seconds")
+        {
+            seconds = juce::String(argv[i + 1]).getDoubleValue();
+        }
+    }
+
+    const juce::AudioBuffer<float> input = make_input(seconds);
+    juce::VST3PluginFormat vst3_format;
+    std::unique_ptr<juce::PluginDescription> vst3_description = find_plugin(vst3_format, vst3_path);
+    std::unique_ptr<juce::AudioPluginInstance> vst3;
+    if (vst3_description)
+    {
+        vst3 = create_plugin(vst3_format, *vst3_description);
+    }
+    const std::unique_ptr<ClapLibrary> clap = ClapLibrary::open(clap_path);
+    bench_creation(vst3_format, vst3 ? vst3_description.get() : nullptr, clap.get());
+    print_convolution_table(input);
+
+    std::printf("%.1f s of stereo noise at %.0f Hz per run, ns/sample and overhead\n\n", seconds,
+                sample_rate);
+    std::printf("%6s %-8s %10s %10s %10s %10s %10s\n", "block", "automate", "engine", "vst3", "",
+                "clap", "");
+    for (int block_size : block_sizes)
+    {
+        for (const Density &density : densities)
+        {
+            const int changes = density.changes_per_block(block_size);
+            const double engine = bench_engine(input, block_size, changes);
+            std::printf("%6d %-8s %10.1f", block_size, density.name, engine);
+            print_timing(vst3 ? bench_plugin(*vst3, input, block_size, changes) : 0, engine);
+            print_timing(clap ? bench_clap(*clap, input, block_size, changes) : 0, engine);
+            std::printf("\n");
+        }
+    }
+    return 0;
+}
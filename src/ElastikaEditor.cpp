@@ -104,6 +104,17 @@ ElastikaEditor::ElastikaEditor(ElastikaAudioProcessor &p)
     outr_vu = make_led_vu("audio_right_output", processor.outr_level);
 
     limiter_warning = make_led_vu("power_toggle", processor.internal_distortion);
+    // The panel has no place for it, so the governor's LED sits beside the limiter's.
+    governor_warning = make_led_vu("power_toggle", processor.governor_level, 4.f);
+    shown_governor_level = processor.governor_level.load();
+    // Unlike the other LEDs, this one has to show changes while the editor is open.
+    startTimerHz(governor_poll_hz);
+
+    // Hidden until requested from the context menu.
+    perf_overlay = std::make_unique<sapphire::PerfOverlay>(processor.perf);
+    addChildComponent(*perf_overlay);
+    spectrum = std::make_unique<sapphire::SpectrumView>(processor.analyzer);
+    addChildComponent(*spectrum);
 
     setSize(300, 600);
     setResizable(true, true);
@@ -118,6 +129,53 @@ void ElastikaEditor::resized()
     {
         background->setTransformToFit(getLocalBounds().toFloat(), juce::RectanglePlacement());
     }
+    if (perf_overlay)
+    {
+        perf_overlay->setBounds(getLocalBounds().removeFromTop(getHeight() / 3));
+    }
+    if (spectrum)
+    {
+        spectrum->setBounds(getLocalBounds().removeFromBottom(getHeight() / 4));
+    }
+}
+
+void ElastikaEditor::mouseDown(const juce::MouseEvent &e)
+{
+    // The background lets clicks through to us, so this is any click on the bare panel.
+    if (e.mods.isPopupMenu())
+    {
+        show_context_menu();
+    }
+}
+
+void ElastikaEditor::timerCallback()
+{
+    const float level = processor.governor_level.load(std::memory_order_relaxed);
+    if (level != shown_governor_level)
+    {
+        shown_governor_level = level;
+        governor_warning->repaint();
+    }
+}
+
+void ElastikaEditor::show_context_menu()
+{
+    juce::PopupMenu menu;
+    menu.addItem("Show performance overlay", true, perf_overlay->isVisible(),
+                 [this]() { perf_overlay->setVisible(!perf_overlay->isVisible()); });
+    menu.addItem("Reset performance statistics", [this]() { processor.perf.requestReset(); });
+    menu.addItem("Show spectrum analyzer", true, spectrum->isVisible(),
+                 [this]() { spectrum->setVisible(!spectrum->isVisible()); });
+    menu.addSeparator();
+    menu.addItem("Adaptive CPU governor", true, processor.governorEnabled.load(),
+                 [this]() { processor.governorEnabled.store(!processor.governorEnabled.load()); });
+    menu.addItem("Convolution mode at low drive", true, processor.convolutionMode->get(), [this]() {
+        juce::AudioParameterBool *p = processor.convolutionMode;
+        p->beginChangeGesture();
+        *p = !p->get();
+        p->endChangeGesture();
+    });
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(this));
 }
 
 std::unique_ptr<juce::Slider> ElastikaEditor::make_large_knob(const std::string &pos)
@@ -163,10 +221,11 @@ std::unique_ptr<juce::Slider> ElastikaEditor::make_small_knob(const std::string
 }
 
 std::unique_ptr<sapphire::LedVu> ElastikaEditor::make_led_vu(const std::string &pos,
-                                                             const std::atomic<float> &source)
+                                                             const std::atomic<float> &source,
+                                                             float offset_x)
 {
     auto r = Sapphire::FindComponent("elastika", pos);
-    auto cx = r.cx;
+    auto cx = r.cx + offset_x;
     auto cy = r.cy;
 
     static constexpr float dx = 0.5f;
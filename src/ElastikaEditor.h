@@ -6,6 +6,8 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include "ElastikaProcessor.h"
 #include "led_vu.h"
+#include "perf_overlay.h"
+#include "spectrum_view.h"
 
 // A tuple of several UI elements that control the physics of the simulation.
 // (1) An input knob for attenuverting the sidechain input, if it exists.
@@ -18,21 +20,27 @@ struct PhysicsControl
     std::unique_ptr<juce::Slider> slider;
 };
 
-class ElastikaEditor : public juce::AudioProcessorEditor
+class ElastikaEditor : public juce::AudioProcessorEditor, private juce::Timer
 {
   public:
     ElastikaEditor(ElastikaAudioProcessor &);
     ~ElastikaEditor();
 
     void resized() override;
+    void mouseDown(const juce::MouseEvent &e) override;
+    void timerCallback() override;
 
   private:
+    static constexpr int governor_poll_hz = 10;
+
     // Convenience functions for constructing controls.
     std::unique_ptr<juce::Slider> make_large_knob(const std::string &pos);
     std::unique_ptr<juce::Slider> make_small_knob(const std::string &pos);
     std::unique_ptr<sapphire::LedVu> make_led_vu(const std::string &pos,
-                                                 const std::atomic<float> &source);
+                                                 const std::atomic<float> &source,
+                                                 float offset_x = 0.f);
     std::unique_ptr<juce::Slider> make_slider(const std::string &pos);;
+    void show_context_menu();
 
     ElastikaAudioProcessor &processor;
     std::unique_ptr<juce::LookAndFeel_V4> lnf;
@@ -52,6 +60,10 @@ class ElastikaEditor : public juce::AudioProcessorEditor
     std::unique_ptr<sapphire::LedVu> outl_vu;
     std::unique_ptr<sapphire::LedVu> outr_vu;
     std::unique_ptr<sapphire::LedVu> limiter_warning;
+    std::unique_ptr<sapphire::LedVu> governor_warning;
+    float shown_governor_level = 0.f;
+    std::unique_ptr<sapphire::PerfOverlay> perf_overlay;
+    std::unique_ptr<sapphire::SpectrumView> spectrum;
     std::vector<std::unique_ptr<juce::SliderParameterAttachment>> attachments;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ElastikaEditor)
@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <cmath>
+#include <utility>
 
 #include "ElastikaProcessor.h"
 #include "ElastikaEditor.h"
@@ -13,6 +14,37 @@ inline float rms_to_intensity(float rms)
     return std::pow(rms, 3.f);
 }
 
+// A factory program: a value for every physics parameter (in ElastikaAudioProcessor::ParamIndex
+// order, in the parameters' own units) and how long switching to it takes.
+struct Program
+{
+    const char *name;
+    float morph_seconds;
+    std::array<float, ElastikaAudioProcessor::NUM_PROGRAM_PARAMS> values;
+};
+
+// friction, span, stiffness, curl, mass, drive, gain, input tilt, output tilt
+const Program programs[] = {
+    {"Default", 0.05f, {0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 1.0f, 0.5f, 0.5f}},
+    {"Tight Box", 0.25f, {0.8f, 0.3f, 0.7f, 0.0f, 0.0f, 1.0f, 1.0f, 0.5f, 0.5f}},
+    {"Long Bloom", 1.5f, {0.15f, 0.7f, 0.35f, 0.0f, 0.2f, 0.8f, 1.1f, 0.4f, 0.6f}},
+    {"Curled Metal", 0.75f, {0.35f, 0.55f, 0.8f, 0.6f, -0.3f, 1.2f, 0.9f, 0.7f, 0.6f}},
+    {"Heavy Drift", 2.0f, {0.25f, 0.85f, 0.2f, -0.2f, 0.7f, 0.9f, 1.1f, 0.3f, 0.35f}},
+    {"Bright Rattle", 0.5f, {0.6f, 0.2f, 0.9f, 0.1f, -0.6f, 1.4f, 0.8f, 0.8f, 0.75f}},
+};
+
+constexpr int num_programs = static_cast<int>(sizeof(programs) / sizeof(programs[0]));
+
+float channel_rms(const float *samples, int n)
+{
+    double sum = 0.0;
+    for (int s = 0; s < n; ++s)
+    {
+        sum += static_cast<double>(samples[s]) * samples[s];
+    }
+    return static_cast<float>(std::sqrt(sum / n));
+}
+
 } // namespace
 
 ElastikaAudioProcessor::ElastikaAudioProcessor()
@@ -20,7 +52,7 @@ ElastikaAudioProcessor::ElastikaAudioProcessor()
                          .withInput("Input", juce::AudioChannelSet::stereo(), true)
                          .withOutput("Output", juce::AudioChannelSet::stereo(), true))
 {
-    engine = std::make_unique<Sapphire::ElastikaEngine>();
+    engine = std::make_unique<Sapphire::ElastikaEngine>(prototype->engine);
     addParameter(friction.param =
                      new juce::AudioParameterFloat({"friction", 1}, "Friction", 0.f, 1.f, 0.5f));
     addParameter(span.param = new juce::AudioParameterFloat({"span", 1}, "Span", 0.f, 1.f, 0.5f));
@@ -35,6 +67,21 @@ ElastikaAudioProcessor::ElastikaAudioProcessor()
                      new juce::AudioParameterFloat({"inputTilt", 1}, "InputTilt", 0.f, 1.f, 0.5f));
     addParameter(outputTilt.param = new juce::AudioParameterFloat({"outputTilt", 1}, "OutputTilt",
                                                                   0.f, 1.f, 0.5f));
+    addParameter(mix.param = new juce::AudioParameterFloat({"mix", 1}, "Mix", 0.f, 1.f, 1.f));
+    addParameter(convolutionMode =
+                     new juce::AudioParameterBool({"convolutionMode", 1}, "ConvolutionMode", false));
+
+    params[FRICTION] = &friction;
+    params[SPAN] = &span;
+    params[STIFFNESS] = &stiffness;
+    params[CURL] = &curl;
+    params[MASS] = &mass;
+    params[DRIVE] = &drive;
+    params[GAIN] = &gain;
+    params[INPUT_TILT] = &inputTilt;
+    params[OUTPUT_TILT] = &outputTilt;
+    params[MIX] = &mix;
+    morph.snap(currentTargets());
 }
 
 ElastikaAudioProcessor::~ElastikaAudioProcessor() {}
@@ -49,32 +96,154 @@ bool ElastikaAudioProcessor::isMidiEffect() const { return false; }
 
 double ElastikaAudioProcessor::getTailLengthSeconds() const { return 20.0; }
 
-int ElastikaAudioProcessor::getNumPrograms()
-{
-    return 1; // NB: some hosts don't cope very well if you tell them there are 0 programs,
-              // so this should be at least 1, even if you're not really implementing programs.
-}
+int ElastikaAudioProcessor::getNumPrograms() { return num_programs; }
 
-int ElastikaAudioProcessor::getCurrentProgram() { return 0; }
+int ElastikaAudioProcessor::getCurrentProgram() { return currentProgram; }
 
-void ElastikaAudioProcessor::setCurrentProgram(int index) {}
+void ElastikaAudioProcessor::setCurrentProgram(int index)
+{
+    // Some hosts re-select the current program straight after restoring state; that mustn't throw
+    // away the edits restored with it. Any other selection, even of the current program, loads it.
+    const bool restored = std::exchange(programRestored, false);
+    if (index < 0 || index >= num_programs || (restored && index == currentProgram))
+    {
+        return;
+    }
+    currentProgram = index;
+    const Program &program = programs[index];
+
+    // Publish the program before its values, so the audio thread never sees the new values
+    // without knowing which morph they belong to.
+    pendingProgram.store(index);
+    for (int i = 0; i < NUM_PROGRAM_PARAMS; ++i)
+    {
+        *(params[i]->param) = program.values[i];
+    }
+}
 
-const juce::String ElastikaAudioProcessor::getProgramName(int index) { return "Default"; }
+const juce::String ElastikaAudioProcessor::getProgramName(int index)
+{
+    if (index < 0 || index >= num_programs)
+    {
+        return {};
+    }
+    return programs[index].name;
+}
 
-void ElastikaAudioProcessor::changeProgramName(int index, const juce::String &newName) {}
+void ElastikaAudioProcessor::changeProgramName(int index, const juce::String &newName)
+{
+    // Factory programs can't be renamed.
+}
 
 void ElastikaAudioProcessor::prepareToPlay(double sr, int samplesPerBlock)
 {
     // Set sample rate
     sampleRate = sr;
     perBlockRate = samplesPerBlock;
-    updateLagRates();
+    prepareEngine(sr, std::max(1, samplesPerBlock));
+    // A new stream, perhaps at a new rate: don't carry the old one's energy into it.
+    resetEngine();
+}
+
+void ElastikaAudioProcessor::releaseResources() { releaseEngine(); }
+
+void ElastikaAudioProcessor::reset() { resetEngine(); }
+
+void ElastikaAudioProcessor::prepareEngine(double sample_rate, int max_block)
+{
+    // Hosts often prepare again with the same settings, e.g. for every instance on project load.
+    if (sample_rate == preparedRate && max_block == preparedBlock)
+    {
+        return;
+    }
+    preparedRate = sample_rate;
+    preparedBlock = max_block;
+
+    rate.engine_rate = static_cast<float>(sample_rate);
+    rate.bypass_fade_step = static_cast<float>(1.0 / (bypass_fade_seconds * sample_rate));
+    rate.max_ir_samples = static_cast<int>(convolution_max_ir_seconds * sample_rate);
+    rate.convolution_settle_samples =
+        static_cast<int64_t>(convolution_settle_seconds * sample_rate);
+    rate.convolution_swap_samples = static_cast<int>(convolution_swap_seconds * sample_rate);
+    rate.governor_down_samples = static_cast<int64_t>(governor_down_seconds * sample_rate);
+    rate.governor_up_samples = static_cast<int64_t>(governor_up_seconds * sample_rate);
+
+    // Only grows the allocation, never shrinks it.
+    scratchArena.setSize(NUM_SCRATCH_CHANNELS, max_block, false, false, true);
+    setScratchViews(max_block);
+    scratchSilence.clear();
+
+    const juce::dsp::ProcessSpec spec{sample_rate, static_cast<juce::uint32>(max_block), 2};
+    convFromLeft.prepare(spec);
+    convFromRight.prepare(spec);
+    capture.prepare(sample_rate, rate.max_ir_samples, prototype->engine);
+    perf.prepare(sample_rate);
+    analyzer.prepare(sample_rate);
 }
 
-void ElastikaAudioProcessor::releaseResources()
+void ElastikaAudioProcessor::resetEngine()
 {
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
+    // Copying the shared rest state over the engine reuses its storage: no allocation, no mesh
+    // construction.
+    restoreRestState();
+    morph.snap(currentTargets());
+    morphProgramRemaining = 0;
+    physicsValues = morph.getValues();
+
+    convFromLeft.reset();
+    convFromRight.reset();
+    wetSource = WetSource::PHYSICS;
+    settledSamples = 0;
+    convIrValid = false;
+    captureRefused = false;
+    swapRemaining = 0;
+    handoverRemaining = 0;
+    wetTooHot = false;
+    quietSamples = 0;
+
+    meshAsleep = false;
+    wetGain = bypassed ? 0.f : 1.f;
+}
+
+void ElastikaAudioProcessor::releaseEngine()
+{
+    capture.release();
+    convFromLeft.reset();
+    convFromRight.reset();
+    setScratchViews(0);
+    scratchArena.setSize(0, 0);
+    preparedRate = 0;
+    preparedBlock = 0;
+}
+
+void ElastikaAudioProcessor::setScratchViews(int num_samples)
+{
+    struct View
+    {
+        juce::AudioBuffer<float> &buffer;
+        int first_channel;
+        int num_channels;
+    };
+    const View views[] = {
+        {scratchIn, SCRATCH_IN, 2},
+        {scratchOut, SCRATCH_OUT, 2},
+        {scratchMix, SCRATCH_MIX, 1},
+        {scratchSilence, SCRATCH_SILENCE, 1},
+        {scratchConvLeft, SCRATCH_CONV_LEFT, 2},
+        {scratchConvRight, SCRATCH_CONV_RIGHT, 2},
+    };
+    for (const View &v : views)
+    {
+        if (num_samples == 0)
+        {
+            v.buffer.setSize(0, 0);
+        }
+        else
+        {
+            v.buffer.setDataToReferTo(scratchArena.getArrayOfWritePointers() + v.first_channel,
+                                      v.num_channels, num_samples);
+        }
+    }
 }
 
 bool ElastikaAudioProcessor::isBusesLayoutSupported(const BusesLayout &layouts) const
@@ -89,52 +258,83 @@ bool ElastikaAudioProcessor::isBusesLayoutSupported(const BusesLayout &layouts)
 
 void ElastikaAudioProcessor::processBlock(juce::AudioBuffer<float> &buffer,
                                           juce::MidiBuffer &midiMessages)
+{
+    bypassed = false;
+    processAudio(buffer);
+}
+
+void ElastikaAudioProcessor::processBlockBypassed(juce::AudioBuffer<float> &buffer,
+                                                  juce::MidiBuffer &midiMessages)
+{
+    bypassed = true;
+    processAudio(buffer);
+}
+
+void ElastikaAudioProcessor::processAudio(juce::AudioBuffer<float> &buffer)
 {
     juce::ScopedNoDenormals noDenormals;
+    const int64_t perf_start = perf.start();
+    const int num_samples = buffer.getNumSamples();
 
     auto mainInput = getBusBuffer(buffer, true, 0);
+    auto mainOutput = getBusBuffer(buffer, false, 0);
+    const bool mono = mainInput.getNumChannels() == 1;
 
-    int inChanL = 0;
-    int inChanR = 1;
-    if (mainInput.getNumChannels() == 1)
-        inChanR = 0;
+    const int chunk_size = scratchIn.getNumSamples();
+    if (chunk_size == 0 || num_samples == 0)
+    {
+        // Not prepared, or nothing to do.
+        buffer.clear();
+        return;
+    }
 
-    auto mainOutput = getBusBuffer(buffer, false, 0);
+    updateGovernor(num_samples);
+    updateMorphTargets(num_samples);
+    updateWetSource(num_samples);
 
-    // Snap lag target values.
-    friction.updateLag();
-    span.updateLag();
-    stiffness.updateLag();
-    curl.updateLag();
-    mass.updateLag();
-    drive.updateLag();
-    gain.updateLag();
-    inputTilt.updateLag();
-    outputTilt.updateLag();
-
-    auto *isL = mainInput.getReadPointer(inChanL);
-    auto *isR = mainInput.getReadPointer(inChanR);
-    auto *osL = mainOutput.getWritePointer(0);
-    auto *osR = mainOutput.getWritePointer(1);
-    for (int s = 0; s < buffer.getNumSamples(); ++s)
-    {
-        updateEngineParameters();
-        float opl, opr;
-        engine->process(sampleRate, isL[s], isR[s], opl, opr);
-        osL[s] = opl;
-        osR[s] = opr;
+    // The mesh runs straight on the host's channels: the input and output buses alias the same
+    // memory, but every stage reads a sample's input before writing its output. Scratch space
+    // (sized in prepareToPlay, hence the chunks) only holds what outlives that, like the dry
+    // signal for the mix.
+    ChunkLevels levels;
+    for (int start = 0; start < num_samples; start += chunk_size)
+    {
+        const int n = std::min(chunk_size, num_samples - start);
+        processChunk(n, mainInput.getReadPointer(0, start),
+                     mainInput.getReadPointer(mono ? 0 : 1, start),
+                     mainOutput.getWritePointer(0, start), mainOutput.getWritePointer(1, start),
+                     levels);
     }
 
     // Update data for the warning lights.
-    float db = 20.f * std::log10(1.f + engine->getAgcDistortion());
+    float db = 20.f * std::log10(1.f + std::max(engine->getAgcDistortion(), convolutionLimiting));
+    convolutionLimiting = 0.f;
     db = std::clamp(db / 24.f, 0.f, 1.f);
     db = std::max(internal_distortion.load(std::memory_order_relaxed) * decay_rate, db);
     internal_distortion.store(db, std::memory_order_relaxed);
 
-    float rms_in_l = mainInput.getRMSLevel(inChanL, 0, buffer.getNumSamples());
-    float rms_in_r = mainInput.getRMSLevel(inChanR, 0, buffer.getNumSamples());
-    float rms_out_l = mainOutput.getRMSLevel(0, 0, buffer.getNumSamples());
-    float rms_out_r = mainOutput.getRMSLevel(1, 0, buffer.getNumSamples());
+    if (!meteringEnabled)
+    {
+        // Let the lights fade rather than freeze.
+        inl_level.store(inl_level.load(std::memory_order_relaxed) * decay_rate,
+                        std::memory_order_relaxed);
+        inr_level.store(inr_level.load(std::memory_order_relaxed) * decay_rate,
+                        std::memory_order_relaxed);
+        outl_level.store(outl_level.load(std::memory_order_relaxed) * decay_rate,
+                         std::memory_order_relaxed);
+        outr_level.store(outr_level.load(std::memory_order_relaxed) * decay_rate,
+                         std::memory_order_relaxed);
+        perf.stop(perf_start, num_samples);
+        return;
+    }
+
+    const auto rms = [num_samples](double sum_squares) {
+        return static_cast<float>(std::sqrt(sum_squares / num_samples));
+    };
+    float rms_in_l = rms(levels.in_l);
+    float rms_in_r = rms(levels.in_r);
+    float rms_out_l = rms(levels.out_l);
+    float rms_out_r = rms(levels.out_r);
     rms_in_l = std::max(inl_level.load(std::memory_order_relaxed) * decay_rate,
                         rms_to_intensity(rms_in_l));
     rms_in_r = std::max(inr_level.load(std::memory_order_relaxed) * decay_rate,
@@ -147,6 +347,500 @@ void ElastikaAudioProcessor::processBlock(juce::AudioBuffer<float> &buffer,
     inr_level.store(rms_in_r, std::memory_order_relaxed);
     outl_level.store(rms_out_l, std::memory_order_relaxed);
     outr_level.store(rms_out_r, std::memory_order_relaxed);
+
+    perf.stop(perf_start, num_samples);
+}
+
+void ElastikaAudioProcessor::processChunk(int n, const float *in_l, const float *in_r, float *out_l,
+                                          float *out_r, ChunkLevels &levels)
+{
+    // Once the bypass crossfade has finished, the mesh is fed silence so it rings down, and once
+    // it is quiet it isn't run at all.
+    const bool bypass_done = bypassed && wetGain == 0.f;
+    const bool fully_wet = !bypassed && wetGain == 1.f && !morph.isMoving() && morph[MIX] == 1.f;
+    const bool show_spectrum = meteringEnabled && analyzer.isActive();
+
+    float rms_in_l = 0.f;
+    float rms_in_r = 0.f;
+    if (meteringEnabled)
+    {
+        rms_in_l = channel_rms(in_l, n);
+        rms_in_r = channel_rms(in_r, n);
+    }
+
+    // The output overwrites the input, so copy out whatever of the dry signal is still needed
+    // afterwards. With a mono input both dry channels are the one copy.
+    const float *dry_l = in_l;
+    const float *dry_r = in_r;
+    if (bypass_done)
+    {
+        if (out_l != in_l)
+        {
+            juce::FloatVectorOperations::copy(out_l, in_l, n);
+        }
+        if (out_r != in_r)
+        {
+            juce::FloatVectorOperations::copy(out_r, in_r, n);
+        }
+        dry_l = out_l;
+        dry_r = out_r;
+    }
+    else if (!fully_wet || show_spectrum)
+    {
+        scratchIn.copyFrom(0, 0, in_l, n);
+        dry_l = scratchIn.getReadPointer(0);
+        dry_r = dry_l;
+        if (in_r != in_l)
+        {
+            scratchIn.copyFrom(1, 0, in_r, n);
+            dry_r = scratchIn.getReadPointer(1);
+        }
+    }
+
+    if (!(bypass_done && meshAsleep))
+    {
+        // While bypassed the mesh only rings down, into scratch, behind the dry signal.
+        float *wet_l = bypass_done ? scratchOut.getWritePointer(0) : out_l;
+        float *wet_r = bypass_done ? scratchOut.getWritePointer(1) : out_r;
+        const float *silence = scratchSilence.getReadPointer(0);
+        renderWet(n, bypass_done ? silence : in_l, bypass_done ? silence : in_r, wet_l, wet_r);
+
+        const float rms_wet = std::max(channel_rms(wet_l, n), channel_rms(wet_r, n));
+        meshAsleep = bypass_done && rms_wet < silence_rms;
+    }
+
+    if (!bypass_done && !fully_wet)
+    {
+        mixChunk(n, dry_l, dry_r, out_l, out_r);
+    }
+
+    if (!meteringEnabled)
+    {
+        return;
+    }
+    if (show_spectrum)
+    {
+        analyzer.push(dry_l, dry_r, out_l, out_r, n);
+    }
+    const float rms_out_l = channel_rms(out_l, n);
+    const float rms_out_r = channel_rms(out_r, n);
+    levels.in_l += static_cast<double>(rms_in_l) * rms_in_l * n;
+    levels.in_r += static_cast<double>(rms_in_r) * rms_in_r * n;
+    levels.out_l += static_cast<double>(rms_out_l) * rms_out_l * n;
+    levels.out_r += static_cast<double>(rms_out_r) * rms_out_r * n;
+}
+
+void ElastikaAudioProcessor::updateGovernor(int num_samples)
+{
+    int tier = governorTier.load(std::memory_order_relaxed);
+    if (!governorEnabled.load(std::memory_order_relaxed))
+    {
+        tier = FULL_QUALITY;
+        governorLoad = 0.f;
+        governorOverSamples = 0;
+        governorUnderSamples = 0;
+    }
+    else
+    {
+        // The load of the previous block, against its realtime deadline.
+        governorLoad += (perf.getLastLoad() - governorLoad) * governor_smoothing;
+        if (governorLoad > governor_overload)
+        {
+            governorUnderSamples = 0;
+            governorOverSamples += num_samples;
+            if (governorOverSamples >= rate.governor_down_samples &&
+                tier < NUM_GOVERNOR_TIERS - 1)
+            {
+                ++tier;
+                governorOverSamples = 0;
+            }
+        }
+        else if (governorLoad < governor_headroom)
+        {
+            governorOverSamples = 0;
+            governorUnderSamples += num_samples;
+            if (governorUnderSamples >= rate.governor_up_samples &&
+                tier > FULL_QUALITY)
+            {
+                --tier;
+                governorUnderSamples = 0;
+            }
+        }
+        else
+        {
+            governorOverSamples = 0;
+            governorUnderSamples = 0;
+        }
+    }
+
+    // Dark while the governor is off, green while nothing is given up, then yellow and red.
+    static constexpr float tier_levels[NUM_GOVERNOR_TIERS] = {0.f, 0.95f, 1.f};
+    governorTier.store(tier, std::memory_order_relaxed);
+    governor_level.store(governorEnabled.load(std::memory_order_relaxed) ? tier_levels[tier] : -1.f,
+                         std::memory_order_relaxed);
+    meteringEnabled = tier < NO_METERING;
+}
+
+void ElastikaAudioProcessor::updateWetSource(int num_samples)
+{
+    const Morph::Values &values = morph.getValues();
+    const bool physics_changed =
+        !std::equal(values.begin(), values.begin() + NUM_PROGRAM_PARAMS, physicsValues.begin());
+    if (physics_changed)
+    {
+        physicsValues = values;
+        settledSamples = 0;
+        convIrValid = false;
+        captureRefused = false;
+    }
+    else
+    {
+        settledSamples += num_samples;
+    }
+    if (wetTooHot)
+    {
+        quietSamples = 0;
+        wetTooHot = false;
+    }
+    else
+    {
+        quietSamples += num_samples;
+    }
+
+    // Only the convolution takes real load off the mesh, so the governor's last step forces it.
+    watchWetLevel = convolutionMode->get() || getGovernorTier() == FORCE_CONVOLUTION;
+    if (watchWetLevel)
+    {
+        capture.start();
+    }
+    const bool allowed =
+        watchWetLevel && !bypassed && physicsValues[DRIVE] <= convolution_max_drive;
+    // Loud enough lately for the mesh's limiter to matter.
+    const bool loud = quietSamples < rate.convolution_settle_samples;
+    switch (wetSource)
+    {
+    case WetSource::PHYSICS:
+        if (!allowed || loud || settledSamples < rate.convolution_settle_samples)
+        {
+            break;
+        }
+        if (convIrValid)
+        {
+            // The convolvers still hold this response from before the level last rose.
+            wetSource = WetSource::TO_CONVOLUTION;
+        }
+        else if (!captureRefused)
+        {
+            if (Sapphire::ElastikaEngine *slot = capture.beginRequest())
+            {
+                // Same sized storage, so this copy doesn't allocate.
+                *slot = prototype->engine;
+                applyParameters(*slot, physicsValues);
+                capture.commitRequest(++convGeneration);
+                wetSource = WetSource::CAPTURING;
+            }
+        }
+        break;
+    case WetSource::CAPTURING:
+        if (!allowed || physics_changed)
+        {
+            // The capture stops without touching the convolvers.
+            capture.abandon();
+            wetSource = WetSource::PHYSICS;
+        }
+        else if (capture.getCompletedGeneration() == convGeneration)
+        {
+            const int length = capture.getCompletedLength();
+            if (length == 0)
+            {
+                // Rings for longer than a response we'd convolve with; the mesh stays in charge.
+                captureRefused = true;
+                wetSource = WetSource::PHYSICS;
+            }
+            else if (convFromLeft.getCurrentIRSize() == length &&
+                     convFromRight.getCurrentIRSize() == length)
+            {
+                convIrLength = length;
+                swapRemaining = rate.convolution_swap_samples;
+                wetSource = WetSource::SWAPPING;
+            }
+        }
+        break;
+    case WetSource::SWAPPING:
+        if (physics_changed)
+        {
+            wetSource = WetSource::PHYSICS;
+        }
+        else if (swapRemaining <= 0)
+        {
+            convIrValid = true;
+            wetSource = allowed && !loud ? WetSource::TO_CONVOLUTION : WetSource::PHYSICS;
+        }
+        break;
+    case WetSource::TO_CONVOLUTION:
+        if (!allowed || loud || physics_changed)
+        {
+            // What the mesh is still ringing with is part of the output, so it carries on.
+            wetSource = WetSource::TO_PHYSICS;
+            handoverRemaining = convIrLength;
+        }
+        break;
+    case WetSource::CONVOLUTION:
+        if (!allowed || loud || physics_changed)
+        {
+            // The mesh hasn't been stepped since it rang out; make sure it starts from rest.
+            restoreRestState();
+            wetSource = WetSource::TO_PHYSICS;
+            handoverRemaining = convIrLength;
+        }
+        break;
+    case WetSource::TO_PHYSICS:
+        // Runs to completion in renderWet.
+        break;
+    }
+}
+
+void ElastikaAudioProcessor::renderWet(int n, const float *in_l, const float *in_r, float *out_l,
+                                       float *out_r)
+{
+    const float *silence = scratchSilence.getReadPointer(0);
+    float *mix = scratchMix.getWritePointer(0);
+
+    // The mesh may overwrite the input, so the convolvers take theirs first.
+    switch (wetSource)
+    {
+    case WetSource::PHYSICS:
+        break;
+    case WetSource::CAPTURING:
+    case WetSource::SWAPPING:
+    case WetSource::TO_PHYSICS:
+        loadConvolvers(n, silence, silence);
+        break;
+    case WetSource::TO_CONVOLUTION:
+    case WetSource::CONVOLUTION:
+        loadConvolvers(n, in_l, in_r);
+        break;
+    }
+
+    if (wetSource == WetSource::CONVOLUTION)
+    {
+        for (int s = 0; s < n; ++s)
+        {
+            morph.process();
+            mix[s] = morph[MIX];
+        }
+        // The mesh missed whatever the morph did meanwhile.
+        engineParamsStale = true;
+    }
+    else
+    {
+        const bool to_mesh = wetSource != WetSource::TO_CONVOLUTION;
+        runMesh(n, to_mesh ? in_l : silence, to_mesh ? in_r : silence, out_l, out_r, mix);
+    }
+    const bool mesh_rang_out =
+        wetSource == WetSource::TO_CONVOLUTION &&
+        std::max(channel_rms(out_l, n), channel_rms(out_r, n)) < convolution_handover_rms;
+
+    switch (wetSource)
+    {
+    case WetSource::PHYSICS:
+        break;
+    case WetSource::CAPTURING:
+    case WetSource::SWAPPING:
+        // The convolvers only pick up a newly loaded response, and crossfade to it, while they're
+        // being run.
+        convolve(n, out_l, out_r, ConvolveOutput::DISCARD);
+        break;
+    case WetSource::TO_CONVOLUTION:
+    case WetSource::TO_PHYSICS:
+        convolve(n, out_l, out_r, ConvolveOutput::ADD);
+        break;
+    case WetSource::CONVOLUTION:
+        convolve(n, out_l, out_r, ConvolveOutput::REPLACE);
+        break;
+    }
+
+    if (watchWetLevel)
+    {
+        checkWetLevel(n, out_l, out_r);
+    }
+
+    if (mesh_rang_out)
+    {
+        // Nothing of the mesh can be heard any more, so resetting it is inaudible, and it won't
+        // bring back stale energy when it next takes over.
+        restoreRestState();
+        wetSource = WetSource::CONVOLUTION;
+    }
+    else if (wetSource == WetSource::SWAPPING)
+    {
+        swapRemaining -= n;
+    }
+    else if (wetSource == WetSource::TO_PHYSICS)
+    {
+        handoverRemaining -= n;
+        if (handoverRemaining <= 0)
+        {
+            wetSource = WetSource::PHYSICS;
+        }
+    }
+}
+
+void ElastikaAudioProcessor::checkWetLevel(int n, float *out_l, float *out_r)
+{
+    const bool convolving =
+        wetSource == WetSource::TO_CONVOLUTION || wetSource == WetSource::CONVOLUTION;
+    if (!convolving)
+    {
+        // The mesh limits itself; it only has to say so.
+        if (engine->getAgcDistortion() > 0.f)
+        {
+            wetTooHot = true;
+        }
+        return;
+    }
+
+    const auto range_l = juce::FloatVectorOperations::findMinAndMax(out_l, n);
+    const auto range_r = juce::FloatVectorOperations::findMinAndMax(out_r, n);
+    const float peak = std::max({-range_l.getStart(), range_l.getEnd(), -range_r.getStart(),
+                                 range_r.getEnd()});
+    if (peak <= convolution_max_peak)
+    {
+        return;
+    }
+    // The mesh takes over from the next block. Until then, hold this one to the ceiling.
+    const float reduction = convolution_max_peak / peak;
+    juce::FloatVectorOperations::multiply(out_l, reduction, n);
+    juce::FloatVectorOperations::multiply(out_r, reduction, n);
+    convolutionLimiting = std::max(convolutionLimiting, 1.f / reduction - 1.f);
+    wetTooHot = true;
+}
+
+void ElastikaAudioProcessor::runMesh(int n, const float *in_l, const float *in_r, float *out_l,
+                                     float *out_r, float *mix)
+{
+    if (engineParamsStale)
+    {
+        applyParameters(*engine, morph.getValues());
+        engineParamsStale = false;
+    }
+
+    // Pick the kernel that feeds the engine only the parameters that are actually moving.
+    // Steady parameters were already applied when they last moved.
+    const bool core = morph.isMoving(FRICTION) || morph.isMoving(SPAN) ||
+                      morph.isMoving(STIFFNESS) || morph.isMoving(DRIVE) || morph.isMoving(GAIN);
+    const bool curl_mass = morph.isMoving(CURL) || morph.isMoving(MASS);
+    const bool tilt = morph.isMoving(INPUT_TILT) || morph.isMoving(OUTPUT_TILT);
+    static constexpr MeshKernel kernels[8] = {
+        &ElastikaAudioProcessor::meshKernel<false, false, false>,
+        &ElastikaAudioProcessor::meshKernel<false, false, true>,
+        &ElastikaAudioProcessor::meshKernel<false, true, false>,
+        &ElastikaAudioProcessor::meshKernel<false, true, true>,
+        &ElastikaAudioProcessor::meshKernel<true, false, false>,
+        &ElastikaAudioProcessor::meshKernel<true, false, true>,
+        &ElastikaAudioProcessor::meshKernel<true, true, false>,
+        &ElastikaAudioProcessor::meshKernel<true, true, true>,
+    };
+    (this->*kernels[(core ? 4 : 0) | (curl_mass ? 2 : 0) | (tilt ? 1 : 0)])(n, in_l, in_r, out_l,
+                                                                           out_r, mix);
+}
+
+template <bool Core, bool CurlMass, bool Tilt>
+void ElastikaAudioProcessor::meshKernel(int n, const float *in_l, const float *in_r, float *out_l,
+                                        float *out_r, float *mix)
+{
+    for (int s = 0; s < n; ++s)
+    {
+        morph.process();
+        if constexpr (Core)
+        {
+            engine->setFriction(morph[FRICTION]);
+            engine->setSpan(morph[SPAN]);
+            engine->setStiffness(morph[STIFFNESS]);
+            engine->setDrive(morph[DRIVE]);
+            engine->setGain(morph[GAIN]);
+        }
+        if constexpr (CurlMass)
+        {
+            engine->setCurl(morph[CURL]);
+            engine->setMass(morph[MASS]);
+        }
+        if constexpr (Tilt)
+        {
+            engine->setInputTilt(morph[INPUT_TILT]);
+            engine->setOutputTilt(morph[OUTPUT_TILT]);
+        }
+        engine->process(rate.engine_rate, in_l[s], in_r[s], out_l[s], out_r[s]);
+        mix[s] = morph[MIX];
+    }
+}
+
+void ElastikaAudioProcessor::loadConvolvers(int n, const float *in_l, const float *in_r)
+{
+    scratchConvLeft.copyFrom(0, 0, in_l, n);
+    scratchConvLeft.copyFrom(1, 0, in_l, n);
+    scratchConvRight.copyFrom(0, 0, in_r, n);
+    scratchConvRight.copyFrom(1, 0, in_r, n);
+}
+
+void ElastikaAudioProcessor::convolve(int n, float *out_l, float *out_r, ConvolveOutput output)
+{
+    juce::dsp::AudioBlock<float> from_left(scratchConvLeft);
+    juce::dsp::AudioBlock<float> from_right(scratchConvRight);
+    auto from_left_chunk = from_left.getSubBlock(0, static_cast<size_t>(n));
+    auto from_right_chunk = from_right.getSubBlock(0, static_cast<size_t>(n));
+    convFromLeft.process(juce::dsp::ProcessContextReplacing<float>(from_left_chunk));
+    convFromRight.process(juce::dsp::ProcessContextReplacing<float>(from_right_chunk));
+
+    if (output == ConvolveOutput::DISCARD)
+    {
+        return;
+    }
+    float *const outs[2] = {out_l, out_r};
+    for (int c = 0; c < 2; ++c)
+    {
+        float *out = outs[c];
+        if (output == ConvolveOutput::REPLACE)
+        {
+            juce::FloatVectorOperations::add(out, scratchConvLeft.getReadPointer(c),
+                                             scratchConvRight.getReadPointer(c), n);
+        }
+        else
+        {
+            juce::FloatVectorOperations::add(out, scratchConvLeft.getReadPointer(c), n);
+            juce::FloatVectorOperations::add(out, scratchConvRight.getReadPointer(c), n);
+        }
+    }
+}
+
+void ElastikaAudioProcessor::mixChunk(int n, const float *dry_l, const float *dry_r, float *out_l,
+                                      float *out_r)
+{
+    // Fold the bypass crossfade into the per-sample mix amounts. The engine has no latency, so
+    // the dry signal lines up with the wet one as it is.
+    float *mix = scratchMix.getWritePointer(0);
+    const float direction = bypassed ? -rate.bypass_fade_step : rate.bypass_fade_step;
+    const float wet_start = wetGain;
+    if (wet_start != (bypassed ? 0.f : 1.f))
+    {
+        for (int s = 0; s < n; ++s)
+        {
+            mix[s] *= std::clamp(wet_start + direction * static_cast<float>(s + 1), 0.f, 1.f);
+        }
+        wetGain = std::clamp(wet_start + direction * static_cast<float>(n), 0.f, 1.f);
+    }
+
+    // out = dry + (wet - dry) * mix, over whole contiguous channels. The dry signal was copied to
+    // scratch before the wet one overwrote the input, so it never aliases the output.
+    const float *const drys[2] = {dry_l, dry_r};
+    float *const outs[2] = {out_l, out_r};
+    for (int c = 0; c < 2; ++c)
+    {
+        jassert(drys[c] != outs[c]);
+        juce::FloatVectorOperations::subtract(outs[c], drys[c], n);
+        juce::FloatVectorOperations::multiply(outs[c], mix, n);
+        juce::FloatVectorOperations::add(outs[c], drys[c], n);
+    }
 }
 
 bool ElastikaAudioProcessor::hasEditor() const
@@ -162,6 +856,8 @@ juce::AudioProcessorEditor *ElastikaAudioProcessor::createEditor()
 void ElastikaAudioProcessor::getStateInformation(juce::MemoryBlock &destData)
 {
     juce::XmlElement root{"elastika"};
+    root.setAttribute("program", currentProgram);
+    root.setAttribute("governor", governorEnabled.load());
     juce::XmlElement *params = root.createNewChildElement("parameters");
     for (const juce::AudioProcessorParameter *p : getParameters())
     {
@@ -179,6 +875,12 @@ void ElastikaAudioProcessor::setStateInformation(const void *data, int sizeInByt
     {
         return;
     }
+    // The parameters below hold the program's values (possibly edited), so only remember which
+    // program was selected.
+    currentProgram = std::clamp(root->getIntAttribute("program", 0), 0, num_programs - 1);
+    programRestored = true;
+    governorEnabled.store(root->getBoolAttribute("governor", false));
+
     juce::XmlElement *params = root->getChildByName("parameters");
     if (!params)
     {
@@ -198,40 +900,67 @@ void ElastikaAudioProcessor::setStateInformation(const void *data, int sizeInByt
     }
 }
 
-void ElastikaAudioProcessor::updateLagRates()
-{
-    const float rate = 1.f / static_cast<float>(perBlockRate);
-    friction.lag.setRate(rate);
-    span.lag.setRate(rate);
-    stiffness.lag.setRate(rate);
-    curl.lag.setRate(rate);
-    mass.lag.setRate(rate);
-    drive.lag.setRate(rate);
-    gain.lag.setRate(rate);
-    inputTilt.lag.setRate(rate);
-    outputTilt.lag.setRate(rate);
-}
-
-void ElastikaAudioProcessor::updateEngineParameters()
-{
-    friction.lag.process();
-    span.lag.process();
-    stiffness.lag.process();
-    curl.lag.process();
-    mass.lag.process();
-    drive.lag.process();
-    gain.lag.process();
-    inputTilt.lag.process();
-    outputTilt.lag.process();
-    engine->setFriction(friction.lag.v);
-    engine->setSpan(span.lag.v);
-    engine->setStiffness(stiffness.lag.v);
-    engine->setCurl(curl.lag.v);
-    engine->setMass(mass.lag.v);
-    engine->setDrive(drive.lag.v);
-    engine->setGain(gain.lag.v);
-    engine->setInputTilt(inputTilt.lag.v);
-    engine->setOutputTilt(outputTilt.lag.v);
+void ElastikaAudioProcessor::restoreRestState()
+{
+    *engine = prototype->engine;
+    engineParamsStale = true;
+}
+
+ElastikaAudioProcessor::Morph::Values ElastikaAudioProcessor::currentTargets() const
+{
+    Morph::Values targets;
+    for (int i = 0; i < NUM_PARAMS; ++i)
+    {
+        targets[i] = params[i]->param->get();
+    }
+    return targets;
+}
+
+void ElastikaAudioProcessor::updateMorphTargets(int num_samples)
+{
+    // Read the parameters before the pending program: setCurrentProgram writes them the other way
+    // round, so any program value seen here comes with its program.
+    const Morph::Values targets = currentTargets();
+    const int program = pendingProgram.exchange(-1);
+    if (program >= 0)
+    {
+        morphProgram = program;
+        morphProgramRemaining = std::max(
+            perBlockRate, static_cast<int>(programs[program].morph_seconds * sampleRate));
+    }
+
+    // Ordinary edits ramp over a block. A program's own values ramp over what is left of its
+    // morph time, however many blocks they take to arrive from the message thread.
+    const Morph::Values &current = morph.getTarget();
+    for (int i = 0; i < NUM_PARAMS; ++i)
+    {
+        if (targets[i] == current[i])
+        {
+            continue;
+        }
+        int samples = perBlockRate;
+        if (morphProgramRemaining > 0 && i < NUM_PROGRAM_PARAMS &&
+            std::abs(targets[i] - programs[morphProgram].values[i]) <= program_value_tolerance)
+        {
+            samples = morphProgramRemaining;
+        }
+        morph.setTarget(i, targets[i], samples);
+    }
+    morphProgramRemaining = std::max(0, morphProgramRemaining - num_samples);
+}
+
+void ElastikaAudioProcessor::applyParameters(Sapphire::ElastikaEngine &e,
+                                             const Morph::Values &values)
+{
+    e.setFriction(values[FRICTION]);
+    e.setSpan(values[SPAN]);
+    e.setStiffness(values[STIFFNESS]);
+    e.setCurl(values[CURL]);
+    e.setMass(values[MASS]);
+    e.setDrive(values[DRIVE]);
+    e.setGain(values[GAIN]);
+    e.setInputTilt(values[INPUT_TILT]);
+    e.setOutputTilt(values[OUTPUT_TILT]);
 }
 
 //==============================================================================
@@ -1,42 +1,74 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 
+#include "convolution_queue.h"
 #include "elastika_engine.hpp"
+#include "engine_prototype.h"
 #include "juce_audio_processors/juce_audio_processors.h"
-#include <Lag.h>
+#include "impulse_capture.h"
+#include "param_morph.h"
+#include "perf_meter.h"
+#include "spectrum_feed.h"
 
-// Ties together an audio parameter and its smoother.
+// An audio parameter and the level shown by its (currently unused) VU. Smoothing happens for all
+// parameters at once in ElastikaAudioProcessor::morph.
 struct AudioParameter
 {
     juce::AudioParameterFloat *param;
-    sst::basic_blocks::dsp::SurgeLag<float> lag;
-    float last_value;
     std::atomic<float> level;  // currently unused.
-
-    void updateLag()
-    {
-        last_value = lag.v;
-        lag.newValue(*param);
-    }
 };
 
 class ElastikaAudioProcessor : public juce::AudioProcessor
 {
   public:
+    // Position of each parameter in the smoothed block and in the program table.
+    enum ParamIndex
+    {
+        FRICTION,
+        SPAN,
+        STIFFNESS,
+        CURL,
+        MASS,
+        DRIVE,
+        GAIN,
+        INPUT_TILT,
+        OUTPUT_TILT,
+        MIX,
+        NUM_PARAMS
+    };
+    // Programs set everything but the mix, which belongs to how the effect is used.
+    static constexpr int NUM_PROGRAM_PARAMS = MIX;
+
+    // Steps the CPU governor takes, each cheaper than the last, when an instance runs out of time.
+    enum GovernorTier
+    {
+        FULL_QUALITY,
+        NO_METERING,       // Skip the meters and stop feeding the spectrum view.
+        FORCE_CONVOLUTION, // Also swap the mesh for its convolution wherever convolution mode
+                           // could, even with the mode off.
+        NUM_GOVERNOR_TIERS
+    };
+
     ElastikaAudioProcessor();
     ~ElastikaAudioProcessor();
 
+    // The engine at rest, shared by every instance in the process. Copying it over engine reuses
+    // engine's storage, so it is safe on the audio thread.
+    juce::SharedResourcePointer<sapphire::EnginePrototype> prototype;
     std::unique_ptr<Sapphire::ElastikaEngine> engine;
     double sampleRate{0};
     int perBlockRate{0};
 
     void prepareToPlay(double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
 
     bool isBusesLayoutSupported(const BusesLayout &layouts) const override;
 
     void processBlock(juce::AudioBuffer<float> &, juce::MidiBuffer &) override;
+    void processBlockBypassed(juce::AudioBuffer<float> &, juce::MidiBuffer &) override;
 
     juce::AudioProcessorEditor *createEditor() override;
     bool hasEditor() const override;
@@ -66,6 +98,10 @@ class ElastikaAudioProcessor : public juce::AudioProcessor
     AudioParameter gain;
     AudioParameter inputTilt;
     AudioParameter outputTilt;
+    AudioParameter mix;
+    // Swap the mesh for a convolution with its impulse response while the drive is low, the
+    // physics parameters are still and the level stays clear of the mesh's limiter.
+    juce::AudioParameterBool *convolutionMode;
 
     std::atomic<float> internal_distortion;
     std::atomic<float> inl_level;
@@ -73,11 +109,195 @@ class ElastikaAudioProcessor : public juce::AudioProcessor
     std::atomic<float> outl_level;
     std::atomic<float> outr_level;
 
+    // Timing of processBlock, shown by the editor's debug overlay and queryable by benchmarks.
+    sapphire::PerfMeter perf;
+    sapphire::PerfStats getPerfStats() const { return perf.getStats(); }
+
+    // Samples for the editor's spectrum view, only fed while it is showing.
+    sapphire::SpectrumFeed analyzer;
+
+    // The governor only steps down when enabled. The current tier is shown on the governor LED
+    // (through governor_level, negative while the governor is off) and can be polled for
+    // monitoring.
+    std::atomic<bool> governorEnabled{false};
+    std::atomic<float> governor_level{-1.f};
+    int getGovernorTier() const { return governorTier.load(std::memory_order_relaxed); }
+
   private:
     static constexpr const float decay_rate = 0.707;
 
-    void updateEngineParameters();
-    void updateLagRates();
+    using Morph = sapphire::ParamMorph<NUM_PARAMS>;
+
+    static constexpr const float silence_rms = 1e-6f; // -120 dB
+    static constexpr const double bypass_fade_seconds = 0.02;
+    // Parameters go through a normalised round trip, so a program's value can come back from the
+    // parameter a rounding error away.
+    static constexpr const float program_value_tolerance = 1e-5f;
+
+    // Governor: step down when the smoothed load stays above governor_overload for a moment, step
+    // back up only after a long stretch below governor_headroom.
+    static constexpr const float governor_overload = 0.75f;
+    static constexpr const float governor_headroom = 0.35f;
+    static constexpr const float governor_smoothing = 0.2f;
+    static constexpr const double governor_down_seconds = 0.05;
+    static constexpr const double governor_up_seconds = 2.0;
+
+    // Convolution mode.
+    static constexpr const float convolution_max_drive = 0.5f;
+    static constexpr const double convolution_settle_seconds = 0.5;
+    static constexpr const double convolution_max_ir_seconds = 2.0;
+    // The mesh hands over to the convolution once it has rung out below this (-90 dB).
+    static constexpr const float convolution_handover_rms = 3e-5f;
+    // juce::dsp::Convolution crossfades from its previous response for about 50 ms after
+    // installing a new one. The new one only takes the input once that is well over.
+    static constexpr const double convolution_swap_seconds = 0.1;
+    // The response is captured in the mesh's linear region, so the convolution has no limiter of
+    // its own. Above this peak the mesh takes back over, and its limiter with it.
+    static constexpr const float convolution_max_peak = 0.5f; // -6 dB
+
+    // Where the wet signal comes from. Switching between the mesh and the convolution is a
+    // handover rather than a crossfade: the outgoing one is fed silence and left to ring out while
+    // the incoming one takes the input, and their outputs are summed. For a linear mesh that is
+    // exactly what the mesh alone would have produced. The mesh rings out until it is inaudible,
+    // the convolution for the length of its response.
+    enum class WetSource
+    {
+        PHYSICS,        // Mesh only.
+        CAPTURING,      // Mesh only, impulse response being captured.
+        SWAPPING,       // Mesh only, convolvers crossfading to the new response.
+        TO_CONVOLUTION, // Convolution takes the input, mesh rings out.
+        CONVOLUTION,    // Convolution only, mesh at rest.
+        TO_PHYSICS,     // Mesh takes the input from rest, convolution rings out.
+    };
+
+    enum class ConvolveOutput
+    {
+        DISCARD,
+        ADD,
+        REPLACE
+    };
+
+    // Everything derived from the sample rate, worked out once in prepareEngine.
+    struct RateConstants
+    {
+        float engine_rate = 0.f; // What the engine is told the sample rate is.
+        float bypass_fade_step = 0.f;
+        int max_ir_samples = 0;
+        int64_t convolution_settle_samples = 0;
+        int convolution_swap_samples = 0;
+        int64_t governor_down_samples = 0;
+        int64_t governor_up_samples = 0;
+    };
+
+    // Layout of the scratch arena: every per-chunk buffer is a view onto one allocation.
+    enum ScratchChannel
+    {
+        SCRATCH_IN = 0,         // 2 channels
+        SCRATCH_OUT = 2,        // 2 channels
+        SCRATCH_MIX = 4,        // 1 channel
+        SCRATCH_SILENCE = 5,    // 1 channel
+        SCRATCH_CONV_LEFT = 6,  // 2 channels
+        SCRATCH_CONV_RIGHT = 8, // 2 channels
+        NUM_SCRATCH_CHANNELS = 10
+    };
+
+    // Engine lifecycle. prepareEngine sets up everything that depends on the sample rate and block
+    // size (and does nothing more when neither changed), resetEngine puts the mesh back at rest
+    // without allocating, and releaseEngine frees what prepareEngine set up.
+    void prepareEngine(double sample_rate, int max_block);
+    void resetEngine();
+    void releaseEngine();
+    void setScratchViews(int num_samples);
+
+    // Sums of squares over a host block, accumulated chunk by chunk for the meters.
+    struct ChunkLevels
+    {
+        double in_l = 0;
+        double in_r = 0;
+        double out_l = 0;
+        double out_r = 0;
+    };
+
+    void processAudio(juce::AudioBuffer<float> &buffer);
+    void processChunk(int n, const float *in_l, const float *in_r, float *out_l, float *out_r,
+                      ChunkLevels &levels);
+    void mixChunk(int n, const float *dry_l, const float *dry_r, float *out_l, float *out_r);
+    void updateGovernor(int num_samples);
+    void updateWetSource(int num_samples);
+    void renderWet(int n, const float *in_l, const float *in_r, float *out_l, float *out_r);
+    void runMesh(int n, const float *in_l, const float *in_r, float *out_l, float *out_r,
+                 float *mix);
+    // Full-rate mesh loop, specialized on which groups of engine parameters are being smoothed.
+    template <bool Core, bool CurlMass, bool Tilt>
+    void meshKernel(int n, const float *in_l, const float *in_r, float *out_l, float *out_r,
+                    float *mix);
+    using MeshKernel = void (ElastikaAudioProcessor::*)(int, const float *, const float *,
+                                                        float *, float *, float *);
+    void loadConvolvers(int n, const float *in_l, const float *in_r);
+    void convolve(int n, float *out_l, float *out_r, ConvolveOutput output);
+    void checkWetLevel(int n, float *out_l, float *out_r);
+
+    void restoreRestState();
+
+    void updateMorphTargets(int num_samples);
+    static void applyParameters(Sapphire::ElastikaEngine &e, const Morph::Values &values);
+    Morph::Values currentTargets() const;
+
+    std::array<AudioParameter *, NUM_PARAMS> params;
+    Morph morph;
+    // Set when the engine may not hold the current smoothed values, e.g. after being reset.
+    bool engineParamsStale{true};
+    RateConstants rate;
+    double preparedRate{0};
+    int preparedBlock{0};
+    // Whole-chunk working storage: one allocation, sized in prepareEngine, and views onto it.
+    juce::AudioBuffer<float> scratchArena;
+    juce::AudioBuffer<float> scratchIn;  // The dry signal, when the mix or the spectrum needs it.
+    juce::AudioBuffer<float> scratchOut; // The mesh ringing down behind a finished bypass.
+    juce::AudioBuffer<float> scratchMix;     // Per-sample wet amount.
+    juce::AudioBuffer<float> scratchSilence; // Stays clear; feeds the mesh while bypassed.
+    // Soft bypass: wetGain fades between 1 (processing) and 0 (bypassed).
+    bool bypassed{false};
+    bool meshAsleep{false};
+    float wetGain{1.f};
+
+    std::atomic<int> governorTier{FULL_QUALITY};
+    bool meteringEnabled{true};
+    float governorLoad{0.f};
+    int64_t governorOverSamples{0};
+    int64_t governorUnderSamples{0};
+
+    juce::SharedResourcePointer<sapphire::ConvolutionQueue> convolutionQueue;
+    juce::dsp::Convolution convFromLeft{convolutionQueue->queue};
+    juce::dsp::Convolution convFromRight{convolutionQueue->queue};
+    sapphire::ImpulseCapture capture{convFromLeft, convFromRight};
+    juce::AudioBuffer<float> scratchConvLeft;  // Left input on both channels.
+    juce::AudioBuffer<float> scratchConvRight; // Right input on both channels.
+    WetSource wetSource{WetSource::PHYSICS};
+    Morph::Values physicsValues{}; // Smoothed values at the end of the last block.
+    int64_t settledSamples{0};     // How long physicsValues has been unchanged.
+    int convGeneration{0};
+    int convIrLength{0};        // Length of the response in the convolvers.
+    bool convIrValid{false};    // That response is the current physics'.
+    bool captureRefused{false}; // The last capture rang too long; wait for the physics to change.
+    int swapRemaining{0};
+    int handoverRemaining{0};
+    // The wet level is only watched while convolution mode is in use. Set by renderWet when the
+    // mesh limited or the convolution went over convolution_max_peak; quietSamples counts how long
+    // that hasn't happened.
+    bool watchWetLevel{false};
+    bool wetTooHot{false};
+    int64_t quietSamples{0};
+    float convolutionLimiting{0.f}; // Shown on the distortion light like the mesh's own.
+    int currentProgram{0};
+    // Set by setStateInformation until the next setCurrentProgram.
+    bool programRestored{false};
+    // Set by setCurrentProgram, consumed by the audio thread: the program whose morph the next
+    // retarget starts. Negative when no program change is pending.
+    std::atomic<int> pendingProgram{-1};
+    // Audio thread: the program being morphed to, and how much of its morph time is left.
+    int morphProgram{0};
+    int morphProgramRemaining{0};
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ElastikaAudioProcessor)
 };
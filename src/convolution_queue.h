@@ -0,0 +1,18 @@
+#pragma once
+
+#include "juce_dsp/juce_dsp.h"
+
+namespace sapphire
+{
+
+// The background thread that hands newly loaded impulse responses to juce::dsp::Convolution. By
+// default every Convolution starts its own; holding one of these through a
+// juce::SharedResourcePointer and constructing the convolvers from its queue gives the whole
+// process a single one, which goes away with the last plugin instance. Responses may only be pushed
+// to it from one thread at a time, so they are all loaded from the one CaptureWorker.
+struct ConvolutionQueue
+{
+    juce::dsp::ConvolutionMessageQueue queue;
+};
+
+} // namespace sapphire
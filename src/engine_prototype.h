@@ -0,0 +1,18 @@
+#pragma once
+
+#include "elastika_engine.hpp"
+
+namespace sapphire
+{
+
+// An ElastikaEngine as constructed, with its mesh exactly at rest. Building one always gives the
+// same result, so it is done once per process: hold one of these through a
+// juce::SharedResourcePointer and copy it, which also lets the audio thread restore the rest state
+// without allocating. Each instance still owns a full copy. It is never modified, so any thread
+// may copy from it, and it goes away with the last plugin instance.
+struct EnginePrototype
+{
+    const Sapphire::ElastikaEngine engine;
+};
+
+} // namespace sapphire
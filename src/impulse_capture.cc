@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <cmath>
+
+#include "impulse_capture.h"
+
+namespace sapphire
+{
+
+ImpulseCapture::ImpulseCapture(juce::dsp::Convolution &from_left,
+                               juce::dsp::Convolution &from_right)
+    : from_left_(from_left), from_right_(from_right)
+{
+}
+
+ImpulseCapture::~ImpulseCapture() { release(); }
+
+void ImpulseCapture::prepare(double sample_rate, int max_ir_samples,
+                             const Sapphire::ElastikaEngine &rest)
+{
+    release();
+    sample_rate_ = sample_rate;
+    max_ir_samples_ = max_ir_samples;
+    rest_ = &rest;
+    state_.store(IDLE, std::memory_order_relaxed);
+    wanted_.store(-1, std::memory_order_relaxed);
+    completed_.store(-1, std::memory_order_relaxed);
+    completed_length_.store(0, std::memory_order_relaxed);
+}
+
+void ImpulseCapture::release()
+{
+    cancelPendingUpdate();
+    start_requested_.store(false, std::memory_order_relaxed);
+    if (worker_)
+    {
+        // A capture in progress stops at its next check rather than running to the end.
+        leaving_.store(true, std::memory_order_relaxed);
+        (*worker_)->remove(*this);
+        worker_.reset();
+    }
+    joined_.store(false, std::memory_order_relaxed);
+    slot_.reset();
+    state_.store(IDLE, std::memory_order_relaxed);
+}
+
+void ImpulseCapture::start()
+{
+    if (!joined_.load(std::memory_order_relaxed) &&
+        !start_requested_.exchange(true, std::memory_order_relaxed))
+    {
+        triggerAsyncUpdate();
+    }
+}
+
+void ImpulseCapture::handleAsyncUpdate()
+{
+    if (rest_ && !worker_)
+    {
+        slot_ = std::make_unique<Sapphire::ElastikaEngine>(*rest_);
+        leaving_.store(false, std::memory_order_relaxed);
+        worker_ = std::make_unique<juce::SharedResourcePointer<CaptureWorker>>();
+        (*worker_)->add(*this);
+        joined_.store(true, std::memory_order_release);
+    }
+    start_requested_.store(false, std::memory_order_relaxed);
+}
+
+Sapphire::ElastikaEngine *ImpulseCapture::beginRequest()
+{
+    if (!joined_.load(std::memory_order_acquire) || state_.load(std::memory_order_acquire) != IDLE)
+    {
+        return nullptr;
+    }
+    return slot_.get();
+}
+
+void ImpulseCapture::commitRequest(int generation)
+{
+    generation_ = generation;
+    wanted_.store(generation, std::memory_order_relaxed);
+    state_.store(REQUESTED, std::memory_order_release);
+    (*worker_)->wake();
+}
+
+void ImpulseCapture::run(const CaptureWorker &worker)
+{
+    state_.store(CAPTURING, std::memory_order_relaxed);
+    capture(worker);
+    state_.store(IDLE, std::memory_order_release);
+}
+
+bool ImpulseCapture::shouldStop(const CaptureWorker &worker, int generation) const
+{
+    return worker.stopping() || leaving_.load(std::memory_order_relaxed) ||
+           wanted_.load(std::memory_order_acquire) != generation;
+}
+
+void ImpulseCapture::capture(const CaptureWorker &worker)
+{
+    const int generation = generation_;
+    const float sr = static_cast<float>(sample_rate_);
+    float l, r;
+
+    Sapphire::ElastikaEngine quiet = *slot_;
+    const int settle = static_cast<int>(settle_seconds_ * sample_rate_);
+    for (int s = 0; s < settle && !shouldStop(worker, generation); ++s)
+    {
+        quiet.process(sr, 0.f, 0.f, l, r);
+    }
+
+    // Whatever the mesh still does by itself is measured on an unkicked copy and subtracted, which
+    // leaves just the response to the impulse. Measure until it has died away, with room after the
+    // longest allowed response for the quiet stretch that shows it has, and for the length tag.
+    const int quiet_samples = static_cast<int>(quiet_seconds_ * sample_rate_);
+    const int fade_samples = std::max(1, static_cast<int>(fade_seconds_ * sample_rate_));
+    Sapphire::ElastikaEngine kicked_left = quiet;
+    Sapphire::ElastikaEngine kicked_right = quiet;
+    juce::AudioBuffer<float> left(2, max_ir_samples_ + quiet_samples + length_tags);
+    juce::AudioBuffer<float> right(2, max_ir_samples_ + quiet_samples + length_tags);
+    const float inv_level = 1.f / impulse_level_;
+    int last_loud = 0;
+    int s = 0;
+    for (; s < left.getNumSamples() && s - last_loud < quiet_samples; ++s)
+    {
+        if (shouldStop(worker, generation))
+        {
+            return;
+        }
+        const float kick = s == 0 ? impulse_level_ : 0.f;
+        float ql, qr, ll, lr, rl, rr;
+        quiet.process(sr, 0.f, 0.f, ql, qr);
+        kicked_left.process(sr, kick, 0.f, ll, lr);
+        kicked_right.process(sr, 0.f, kick, rl, rr);
+        const float response[4] = {(ll - ql) * inv_level, (lr - qr) * inv_level,
+                                   (rl - ql) * inv_level, (rr - qr) * inv_level};
+        left.setSample(0, s, response[0]);
+        left.setSample(1, s, response[1]);
+        right.setSample(0, s, response[2]);
+        right.setSample(1, s, response[3]);
+        for (float x : response)
+        {
+            if (std::abs(x) > floor_)
+            {
+                last_loud = s;
+            }
+        }
+    }
+    if (s - last_loud < quiet_samples)
+    {
+        // Still ringing: cutting it short would change the sound, so leave the mesh in charge.
+        finish(generation, 0);
+        return;
+    }
+
+    // Everything past last_loud is below the floor; fade over that rather than cut. Padding the
+    // length so it tags this load leaves a response still in the convolvers from an earlier one
+    // (even one loaded just before it was abandoned) length_tags loads away from being mistaken
+    // for it.
+    int length = last_loud + 1 + fade_samples;
+    length += ((loads_ - length) % length_tags + length_tags) % length_tags;
+    for (int i = 0; i < fade_samples; ++i)
+    {
+        const int at = length - fade_samples + i;
+        const float t = static_cast<float>(i + 1) / static_cast<float>(fade_samples);
+        const float gain = 0.5f + 0.5f * std::cos(juce::MathConstants<float>::pi * t);
+        for (int c = 0; c < 2; ++c)
+        {
+            left.setSample(c, at, left.getSample(c, at) * gain);
+            right.setSample(c, at, right.getSample(c, at) * gain);
+        }
+    }
+    left.setSize(2, length, true, false, true);
+    right.setSize(2, length, true, false, true);
+
+    if (shouldStop(worker, generation))
+    {
+        return;
+    }
+    ++loads_;
+    using juce::dsp::Convolution;
+    from_left_.loadImpulseResponse(std::move(left), sample_rate_, Convolution::Stereo::yes,
+                                   Convolution::Trim::no, Convolution::Normalise::no);
+    from_right_.loadImpulseResponse(std::move(right), sample_rate_, Convolution::Stereo::yes,
+                                    Convolution::Trim::no, Convolution::Normalise::no);
+    finish(generation, length);
+}
+
+void ImpulseCapture::finish(int generation, int length)
+{
+    completed_length_.store(length, std::memory_order_relaxed);
+    completed_.store(generation, std::memory_order_release);
+}
+
+CaptureWorker::CaptureWorker() : juce::Thread("Elastika impulse capture") { startThread(); }
+
+CaptureWorker::~CaptureWorker()
+{
+    // Every instance has left by now, so no capture is running.
+    signalThreadShouldExit();
+    notify();
+    stopThread(-1);
+}
+
+void CaptureWorker::add(ImpulseCapture &capture)
+{
+    const juce::ScopedLock lock(lock_);
+    captures_.addIfNotAlreadyThere(&capture);
+}
+
+void CaptureWorker::remove(ImpulseCapture &capture)
+{
+    {
+        const juce::ScopedLock lock(lock_);
+        captures_.removeFirstMatchingValue(&capture);
+    }
+    // Wait out a capture of its that the worker had already picked up.
+    const juce::ScopedLock busy(capture.busy_);
+}
+
+void CaptureWorker::run()
+{
+    int next_index = 0;
+    while (!threadShouldExit())
+    {
+        ImpulseCapture *next = nullptr;
+        {
+            // Take turns, so one busy instance can't keep the others waiting.
+            const juce::ScopedLock lock(lock_);
+            const int count = captures_.size();
+            for (int i = 0; i < count && !next; ++i)
+            {
+                ImpulseCapture *candidate = captures_.getUnchecked((next_index + i) % count);
+                if (candidate->state_.load(std::memory_order_acquire) == ImpulseCapture::REQUESTED)
+                {
+                    next = candidate;
+                    next_index = (next_index + i + 1) % count;
+                }
+            }
+            if (next)
+            {
+                // Taken before letting go of the list, so remove() can't miss it.
+                next->busy_.enter();
+            }
+        }
+        if (!next)
+        {
+            wait(-1);
+            continue;
+        }
+        next->run(*this);
+        next->busy_.exit();
+    }
+}
+
+} // namespace sapphire
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "elastika_engine.hpp"
+#include "juce_dsp/juce_dsp.h"
+#include "juce_events/juce_events.h"
+
+namespace sapphire
+{
+
+class CaptureWorker;
+
+// Measures the stereo impulse response of an ElastikaEngine in the background and loads it into a
+// pair of convolvers: one holding the responses to the left input (left and right outputs), the
+// other the responses to the right input.
+//
+// The audio thread asks for a capture by configuring the engine returned from beginRequest() and
+// then calling commitRequest(). Only one capture per instance is ever in flight, so the audio
+// thread never waits and never touches memory a capture is using. The captures of every instance
+// run on one CaptureWorker, which is therefore the only thread that ever loads responses into the
+// (shared) convolution message queue. Nothing is allocated and no worker exists until start() is
+// first called.
+class ImpulseCapture : private juce::AsyncUpdater
+{
+  public:
+    // Loaded response lengths are tagged with a load counter modulo this, so the audio thread can
+    // tell from Convolution::getCurrentIRSize() when the convolvers have swapped to a new one.
+    static constexpr int length_tags = 64;
+
+    ImpulseCapture(juce::dsp::Convolution &from_left, juce::dsp::Convolution &from_right);
+    ~ImpulseCapture() override;
+
+    // Message thread. Captures are configured from rest, an engine at rest which must outlive
+    // this, and run until the response has died away, up to max_ir_samples.
+    void prepare(double sample_rate, int max_ir_samples, const Sapphire::ElastikaEngine &rest);
+    // Message thread. Leaves the worker, once a capture it is running for us has stopped, and
+    // frees the request slot.
+    void release();
+
+    // Audio thread. Has the request slot allocated and the worker joined, on the message thread.
+    void start();
+    // Audio thread. The engine to configure for the next capture, or nullptr while one is running
+    // or before start() has taken effect.
+    Sapphire::ElastikaEngine *beginRequest();
+    void commitRequest(int generation);
+    // Audio thread. The requested capture is no longer wanted: it stops early and, unless it is
+    // already loading, leaves the convolvers alone.
+    void abandon() { wanted_.store(-1, std::memory_order_release); }
+    // Audio thread. The generation of the most recently finished capture, or -1.
+    int getCompletedGeneration() const { return completed_.load(std::memory_order_acquire); }
+    // Audio thread. The length of the response loaded by that capture, or 0 if the response
+    // hadn't died away within the maximum length and nothing was loaded.
+    int getCompletedLength() const { return completed_length_.load(std::memory_order_relaxed); }
+
+  private:
+    friend class CaptureWorker;
+
+    enum State
+    {
+        IDLE,
+        REQUESTED,
+        CAPTURING
+    };
+
+    // Impulse height. Small, so the mesh stays in its linear region.
+    static constexpr float impulse_level_ = 0.1f;
+    // Time the configured mesh is left alone to settle into its new geometry before measuring.
+    static constexpr double settle_seconds_ = 0.25;
+    // The response has died away once it has stayed below the floor (-80 dB for a unit impulse)
+    // for quiet_seconds_. It is cut there, the last fade_seconds_ faded out.
+    static constexpr float floor_ = 1e-4f;
+    static constexpr double quiet_seconds_ = 0.1;
+    static constexpr double fade_seconds_ = 0.02;
+
+    void handleAsyncUpdate() override;
+    // Worker thread.
+    void run(const CaptureWorker &worker);
+    void capture(const CaptureWorker &worker);
+    bool shouldStop(const CaptureWorker &worker, int generation) const;
+    void finish(int generation, int length);
+
+    juce::dsp::Convolution &from_left_;
+    juce::dsp::Convolution &from_right_;
+    const Sapphire::ElastikaEngine *rest_ = nullptr;
+    std::unique_ptr<Sapphire::ElastikaEngine> slot_;
+    std::unique_ptr<juce::SharedResourcePointer<CaptureWorker>> worker_;
+    // Held by the worker while it captures for this instance.
+    juce::CriticalSection busy_;
+    double sample_rate_ = 0;
+    int max_ir_samples_ = 0;
+    int generation_ = 0;
+    int loads_ = 0; // Worker thread only.
+    std::atomic<int> state_{IDLE};
+    std::atomic<bool> joined_{false};
+    std::atomic<bool> start_requested_{false};
+    std::atomic<bool> leaving_{false};
+    std::atomic<int> wanted_{-1};
+    std::atomic<int> completed_{-1};
+    std::atomic<int> completed_length_{0};
+};
+
+// The one thread, shared through a juce::SharedResourcePointer by every instance that has
+// convolution mode in use, that runs their captures in turn. It sleeps until one is requested.
+class CaptureWorker : private juce::Thread
+{
+  public:
+    CaptureWorker();
+    ~CaptureWorker() override;
+
+    void add(ImpulseCapture &capture);
+    // Returns once a capture running for it has stopped.
+    void remove(ImpulseCapture &capture);
+    void wake() { notify(); }
+    bool stopping() const { return threadShouldExit(); }
+
+  private:
+    void run() override;
+
+    juce::CriticalSection lock_;
+    juce::Array<ImpulseCapture *> captures_;
+};
+
+} // namespace sapphire
@@ -20,7 +20,11 @@ void LedVu::paint(juce::Graphics &g)
 
     juce::Colour shadow_color;
     juce::Colour led_color;
-    if (point < 0.9) {
+    if (point < 0) {
+        // Switched off: no glow.
+        led_color = off_col_;
+        shadow_color = juce::Colours::transparentBlack;
+    } else if (point < 0.9) {
         led_color = good_col_;
         shadow_color = good_shadow_;
     } else if (point < 1) {
@@ -33,7 +37,8 @@ void LedVu::paint(juce::Graphics &g)
 
     juce::DropShadow(shadow_color.withAlpha(0.7f), 1, {}).drawForPath(g, p);
 
-    juce::ColourGradient grad(juce::Colours::white, 0, 0, led_color, diam, diam, true);
+    const juce::Colour highlight = point < 0 ? off_col_.brighter() : juce::Colours::white;
+    juce::ColourGradient grad(highlight, 0, 0, led_color, diam, diam, true);
     g.setGradientFill(grad);
     g.fillPath(p);
 
@@ -7,6 +7,8 @@
 namespace sapphire
 {
 
+// A single LED lit from an atomic level: green below 0.9, yellow below 1, red from there on, and
+// dark for a negative level.
 class LedVu : public juce::Component
 {
   public:
@@ -22,6 +24,7 @@ class LedVu : public juce::Component
     const juce::Colour limit_shadow_ = juce::Colours::mediumvioletred;
     const juce::Colour warning_col_ = juce::Colours::yellow;
     const juce::Colour warning_shadow_ = juce::Colours::lightyellow;
+    const juce::Colour off_col_ = juce::Colours::darkgrey;
     const juce::Colour outline_col_ = juce::Colours::black;
 
     const std::atomic<float>& source_;
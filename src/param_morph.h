@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+namespace sapphire
+{
+
+// Smooths a block of N parameters together with linear ramps. The per-sample increments are
+// computed once whenever a target changes, so advancing a sample is a single element-wise add
+// over contiguous arrays (which the compiler vectorizes) instead of N independent smoothers. Each
+// parameter has its own ramp length, so a slow morph of some doesn't hold up quick edits of others.
+template <size_t N> class ParamMorph
+{
+  public:
+    using Values = std::array<float, N>;
+
+    ParamMorph()
+    {
+        value_.fill(0.f);
+        target_.fill(0.f);
+        step_.fill(0.f);
+        remaining_.fill(0);
+    }
+
+    // Jumps straight to the given values, abandoning any ramps in progress.
+    void snap(const Values &values)
+    {
+        value_ = values;
+        target_ = values;
+        step_.fill(0.f);
+        remaining_.fill(0);
+        active_ = 0;
+    }
+
+    // Ramps parameter i from wherever it is now to the target over the given number of samples.
+    void setTarget(size_t i, float target, int samples)
+    {
+        target_[i] = target;
+        if (samples <= 0)
+        {
+            value_[i] = target;
+            step_[i] = 0.f;
+            remaining_[i] = 0;
+            return;
+        }
+        step_[i] = (target - value_[i]) / static_cast<float>(samples);
+        remaining_[i] = samples;
+        active_ = std::max(active_, samples);
+    }
+
+    // Advances the ramps by one sample.
+    void process()
+    {
+        if (active_ <= 0)
+        {
+            return;
+        }
+        --active_;
+        for (size_t i = 0; i < N; ++i)
+        {
+            value_[i] += step_[i];
+        }
+        for (size_t i = 0; i < N; ++i)
+        {
+            if (remaining_[i] > 0 && --remaining_[i] == 0)
+            {
+                // Land exactly on the target rather than accumulating rounding error.
+                value_[i] = target_[i];
+                step_[i] = 0.f;
+            }
+        }
+    }
+
+    bool isMoving() const { return active_ > 0; }
+    bool isMoving(size_t i) const { return remaining_[i] > 0; }
+    const Values &getTarget() const { return target_; }
+    const Values &getValues() const { return value_; }
+    float operator[](size_t i) const { return value_[i]; }
+
+  private:
+    alignas(16) Values value_;
+    alignas(16) Values target_;
+    alignas(16) Values step_;
+    std::array<int, N> remaining_;
+    int active_ = 0; // The longest remaining ramp.
+};
+
+} // namespace sapphire
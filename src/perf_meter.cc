@@ -0,0 +1,152 @@
+#include <algorithm>
+
+#include "perf_meter.h"
+
+namespace sapphire
+{
+
+namespace
+{
+
+// Single writer, so a load followed by a store is enough (and avoids needing fetch_add on doubles).
+template <typename T> inline void relaxed_add(std::atomic<T> &a, T v)
+{
+    a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+template <typename T> inline void relaxed_max(std::atomic<T> &a, T v)
+{
+    if (v > a.load(std::memory_order_relaxed))
+    {
+        a.store(v, std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+PerfMeter::PerfMeter()
+    : ticks_per_second_(static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()))
+{
+    clear();
+}
+
+void PerfMeter::prepare(double sample_rate)
+{
+    sample_rate_.store(sample_rate, std::memory_order_relaxed);
+    clear();
+}
+
+void PerfMeter::stop(int64_t start_ticks, int num_samples)
+{
+    const int64_t elapsed = juce::Time::getHighResolutionTicks() - start_ticks;
+    const double sample_rate = sample_rate_.load(std::memory_order_relaxed);
+    if (num_samples <= 0 || sample_rate <= 0)
+    {
+        return;
+    }
+
+    if (reset_requested_.exchange(false, std::memory_order_relaxed))
+    {
+        clear();
+    }
+
+    const double seconds = static_cast<double>(elapsed) / ticks_per_second_;
+    const double load = seconds * sample_rate / static_cast<double>(num_samples);
+
+    relaxed_add<uint64_t>(blocks_, 1);
+    relaxed_add<uint64_t>(samples_, static_cast<uint64_t>(num_samples));
+    relaxed_add<int64_t>(ticks_, elapsed);
+    relaxed_add(load_sum_, load);
+    relaxed_max(max_load_, load);
+    last_load_.store(static_cast<float>(load), std::memory_order_relaxed);
+
+    const int bin = std::min(static_cast<int>(load * bins_per_load_), num_bins_ - 1);
+    relaxed_add<uint32_t>(bins_[static_cast<size_t>(bin)], 1);
+
+    int size_bucket = 0;
+    while ((1 << size_bucket) < num_samples && size_bucket < num_block_sizes_ - 1)
+    {
+        ++size_bucket;
+    }
+    BlockSizeBucket &b = block_sizes_[static_cast<size_t>(size_bucket)];
+    relaxed_add<uint64_t>(b.blocks, 1);
+    relaxed_add(b.load_sum, load);
+    relaxed_max(b.max_load, load);
+}
+
+PerfStats PerfMeter::getStats() const
+{
+    PerfStats stats;
+    stats.blocks = blocks_.load(std::memory_order_relaxed);
+    stats.last_load = last_load_.load(std::memory_order_relaxed);
+    if (stats.blocks == 0)
+    {
+        return stats;
+    }
+
+    const uint64_t samples = samples_.load(std::memory_order_relaxed);
+    const double seconds = static_cast<double>(ticks_.load(std::memory_order_relaxed)) /
+                           ticks_per_second_;
+    if (samples > 0)
+    {
+        stats.mean_ns_per_sample = seconds * 1e9 / static_cast<double>(samples);
+    }
+    stats.mean_load = load_sum_.load(std::memory_order_relaxed) / static_cast<double>(stats.blocks);
+    stats.max_load = max_load_.load(std::memory_order_relaxed);
+
+    // The histogram may be mid-update, so count what is actually there rather than trusting blocks_.
+    uint64_t total = 0;
+    for (const auto &bin : bins_)
+    {
+        total += bin.load(std::memory_order_relaxed);
+    }
+    const uint64_t p99_rank = total - total / 100;
+    uint64_t seen = 0;
+    for (int i = 0; i < num_bins_; ++i)
+    {
+        seen += bins_[static_cast<size_t>(i)].load(std::memory_order_relaxed);
+        if (seen >= p99_rank)
+        {
+            // Report the upper edge of the bin, clamped to the worst block we actually saw.
+            stats.p99_load = std::min(static_cast<double>(i + 1) / bins_per_load_, stats.max_load);
+            break;
+        }
+    }
+
+    for (int i = 0; i < num_block_sizes_; ++i)
+    {
+        const BlockSizeBucket &b = block_sizes_[static_cast<size_t>(i)];
+        const uint64_t blocks = b.blocks.load(std::memory_order_relaxed);
+        if (blocks == 0)
+        {
+            continue;
+        }
+        stats.block_sizes.push_back({1 << i, blocks,
+                                     b.load_sum.load(std::memory_order_relaxed) /
+                                         static_cast<double>(blocks),
+                                     b.max_load.load(std::memory_order_relaxed)});
+    }
+    return stats;
+}
+
+void PerfMeter::clear()
+{
+    blocks_.store(0, std::memory_order_relaxed);
+    samples_.store(0, std::memory_order_relaxed);
+    ticks_.store(0, std::memory_order_relaxed);
+    load_sum_.store(0, std::memory_order_relaxed);
+    max_load_.store(0, std::memory_order_relaxed);
+    last_load_.store(0, std::memory_order_relaxed);
+    for (auto &bin : bins_)
+    {
+        bin.store(0, std::memory_order_relaxed);
+    }
+    for (auto &b : block_sizes_)
+    {
+        b.blocks.store(0, std::memory_order_relaxed);
+        b.load_sum.store(0, std::memory_order_relaxed);
+        b.max_load.store(0, std::memory_order_relaxed);
+    }
+}
+
+} // namespace sapphire
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "juce_core/juce_core.h"
+
+namespace sapphire
+{
+
+// Summary of the processBlock timings gathered by a PerfMeter. Loads are a fraction of the realtime
+// budget of a block: 1.0 means the block took as long to compute as it lasts when played back.
+struct PerfStats
+{
+    struct BlockSize
+    {
+        int max_samples; // Upper bound (inclusive) of the power-of-two bucket.
+        uint64_t blocks;
+        double mean_load;
+        double max_load;
+    };
+
+    uint64_t blocks = 0;
+    double mean_ns_per_sample = 0;
+    double mean_load = 0;
+    double p99_load = 0;
+    double max_load = 0;
+    double last_load = 0;
+    std::vector<BlockSize> block_sizes; // Only the buckets that have seen any blocks.
+};
+
+// Measures how long each processBlock call takes. There is a single writer (the audio thread,
+// through start/stop) and any number of readers (the editor overlay, tests, benchmarks), so every
+// statistic is a relaxed atomic and nothing ever locks or allocates on the audio thread.
+class PerfMeter
+{
+  public:
+    PerfMeter();
+
+    // Called from prepareToPlay, resets the statistics.
+    void prepare(double sample_rate);
+
+    // Audio thread only.
+    int64_t start() const { return juce::Time::getHighResolutionTicks(); }
+    void stop(int64_t start_ticks, int num_samples);
+
+    // Any thread.
+    PerfStats getStats() const;
+    float getLastLoad() const { return last_load_.load(std::memory_order_relaxed); }
+    void requestReset() { reset_requested_.store(true, std::memory_order_relaxed); }
+
+  private:
+    // Load histogram: bins of 1/64th of the budget up to twice the budget, the last bin collects
+    // everything above that.
+    static constexpr int num_bins_ = 128;
+    static constexpr double bins_per_load_ = 64.0;
+    // Block size buckets: 1, 2, 4, ..., 32768 samples.
+    static constexpr int num_block_sizes_ = 16;
+
+    struct BlockSizeBucket
+    {
+        std::atomic<uint64_t> blocks{0};
+        std::atomic<double> load_sum{0};
+        std::atomic<double> max_load{0};
+    };
+
+    void clear();
+
+    double ticks_per_second_;
+    std::atomic<double> sample_rate_{0};
+    std::atomic<bool> reset_requested_{false};
+
+    std::atomic<uint64_t> blocks_{0};
+    std::atomic<uint64_t> samples_{0};
+    std::atomic<int64_t> ticks_{0};
+    std::atomic<double> load_sum_{0};
+    std::atomic<double> max_load_{0};
+    std::atomic<float> last_load_{0};
+    std::array<std::atomic<uint32_t>, num_bins_> bins_;
+    std::array<BlockSizeBucket, num_block_sizes_> block_sizes_;
+};
+
+} // namespace sapphire
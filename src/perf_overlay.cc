@@ -0,0 +1,66 @@
+#include "perf_overlay.h"
+
+namespace sapphire
+{
+
+namespace
+{
+
+juce::String percent(double load) { return juce::String(load * 100.0, 1) + "%"; }
+
+} // namespace
+
+PerfOverlay::PerfOverlay(const PerfMeter &meter) : meter_(meter)
+{
+    setInterceptsMouseClicks(false, false);
+}
+
+void PerfOverlay::paint(juce::Graphics &g)
+{
+    g.fillAll(background_col_);
+    g.setColour(text_col_);
+    g.setFont(juce::Font(juce::Font::getDefaultMonospacedFontName(), line_height_ - 3.f,
+                         juce::Font::plain));
+
+    juce::StringArray lines;
+    lines.add("blocks " + juce::String(static_cast<juce::int64>(stats_.blocks)) + "  " +
+              juce::String(stats_.mean_ns_per_sample, 1) + " ns/sample");
+    lines.add("load mean " + percent(stats_.mean_load) + "  p99 " + percent(stats_.p99_load) +
+              "  max " + percent(stats_.max_load));
+    lines.add("load last " + percent(stats_.last_load));
+    for (const auto &b : stats_.block_sizes)
+    {
+        lines.add("<=" + juce::String(b.max_samples).paddedLeft(' ', 5) + ": mean " +
+                  percent(b.mean_load) + "  max " + percent(b.max_load) + "  (" +
+                  juce::String(static_cast<juce::int64>(b.blocks)) + ")");
+    }
+
+    auto area = getLocalBounds().toFloat().reduced(4.f);
+    for (const auto &line : lines)
+    {
+        g.drawText(line, area.removeFromTop(line_height_), juce::Justification::centredLeft,
+                   false);
+    }
+}
+
+void PerfOverlay::visibilityChanged()
+{
+    // Only poll the meter while someone is looking at it.
+    if (isVisible())
+    {
+        timerCallback();
+        startTimerHz(refresh_hz_);
+    }
+    else
+    {
+        stopTimer();
+    }
+}
+
+void PerfOverlay::timerCallback()
+{
+    stats_ = meter_.getStats();
+    repaint();
+}
+
+} // namespace sapphire
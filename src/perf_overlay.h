@@ -0,0 +1,30 @@
+#pragma once
+
+#include "juce_gui_basics/juce_gui_basics.h"
+#include "perf_meter.h"
+
+namespace sapphire
+{
+
+// Debug overlay that prints the statistics gathered by a PerfMeter on top of the panel.
+class PerfOverlay : public juce::Component, private juce::Timer
+{
+  public:
+    PerfOverlay(const PerfMeter &meter);
+
+    void paint(juce::Graphics &g) override;
+    void visibilityChanged() override;
+
+  private:
+    static constexpr int refresh_hz_ = 4;
+    static constexpr float line_height_ = 14.f;
+    const juce::Colour background_col_ = juce::Colours::black.withAlpha(0.75f);
+    const juce::Colour text_col_ = juce::Colours::white;
+
+    void timerCallback() override;
+
+    const PerfMeter &meter_;
+    PerfStats stats_;
+};
+
+} // namespace sapphire
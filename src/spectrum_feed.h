@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "juce_core/juce_core.h"
+
+namespace sapphire
+{
+
+// Carries full-rate mono input and output samples from the audio thread to the spectrum view.
+// Single producer (audio thread), single consumer (message thread), wait-free both ways. The
+// audio thread only pushes while a view has marked the feed active, and the buffers are only
+// allocated the first time one does, so an instance whose analyzer is never opened costs nothing.
+class SpectrumFeed
+{
+  public:
+    // Over 80 ms at 192 kHz, more than the view takes between pulls.
+    static constexpr int capacity = 16384;
+
+    SpectrumFeed() : fifo_(capacity) {}
+
+    // Message thread.
+    void prepare(double sample_rate) { sample_rate_.store(sample_rate, std::memory_order_relaxed); }
+    double getSampleRate() const { return sample_rate_.load(std::memory_order_relaxed); }
+    void setActive(bool active)
+    {
+        if (active && !in_)
+        {
+            in_ = std::make_unique<float[]>(capacity);
+            out_ = std::make_unique<float[]>(capacity);
+        }
+        if (active)
+        {
+            // Nothing is pushed while inactive, so whatever is left is from before the view last
+            // closed. This is the consumer's side, so dropping it is safe.
+            fifo_.finishedRead(fifo_.getNumReady());
+        }
+        // Release, so the audio thread sees the buffers before it sees the feed active.
+        active_.store(active, std::memory_order_release);
+    }
+
+    // Audio thread.
+    bool isActive() const { return active_.load(std::memory_order_acquire); }
+
+    // Audio thread. Sums each channel pair to mono in the same pass that copies into the FIFO.
+    // Whatever doesn't fit is dropped.
+    void push(const float *in_l, const float *in_r, const float *out_l, const float *out_r, int n)
+    {
+        int start1, size1, start2, size2;
+        fifo_.prepareToWrite(n, start1, size1, start2, size2);
+        const auto copy = [&](int start, int size, int from) {
+            for (int s = 0; s < size; ++s)
+            {
+                in_[start + s] = 0.5f * (in_l[from + s] + in_r[from + s]);
+                out_[start + s] = 0.5f * (out_l[from + s] + out_r[from + s]);
+            }
+        };
+        copy(start1, size1, 0);
+        copy(start2, size2, size1);
+        fifo_.finishedWrite(size1 + size2);
+    }
+
+    // Message thread. Returns how many samples were copied out.
+    int pull(float *in, float *out, int max)
+    {
+        if (!in_)
+        {
+            return 0;
+        }
+        int start1, size1, start2, size2;
+        fifo_.prepareToRead(max, start1, size1, start2, size2);
+        std::copy_n(in_.get() + start1, size1, in);
+        std::copy_n(out_.get() + start1, size1, out);
+        std::copy_n(in_.get() + start2, size2, in + size1);
+        std::copy_n(out_.get() + start2, size2, out + size1);
+        fifo_.finishedRead(size1 + size2);
+        return size1 + size2;
+    }
+
+  private:
+    juce::AbstractFifo fifo_;
+    // Allocated by the first setActive(true), then kept until the feed goes away: the audio thread
+    // may still be pushing just after the view closes.
+    std::unique_ptr<float[]> in_;
+    std::unique_ptr<float[]> out_;
+    std::atomic<double> sample_rate_{0};
+    std::atomic<bool> active_{false};
+};
+
+} // namespace sapphire
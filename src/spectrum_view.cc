@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cmath>
+
+#include "spectrum_view.h"
+
+namespace sapphire
+{
+
+SpectrumView::SpectrumView(SpectrumFeed &feed)
+    : feed_(feed), fft_(fft_order_),
+      window_(static_cast<size_t>(fft_size_), juce::dsp::WindowingFunction<float>::hann),
+      fft_data_(2 * fft_size_, 0.f), pulled_in_(SpectrumFeed::capacity),
+      pulled_out_(SpectrumFeed::capacity)
+{
+    clearTraces();
+    setInterceptsMouseClicks(false, false);
+}
+
+SpectrumView::~SpectrumView() { feed_.setActive(false); }
+
+void SpectrumView::visibilityChanged()
+{
+    // Only ask the audio thread for samples while someone is looking.
+    const bool showing = isVisible();
+    feed_.setActive(showing);
+    if (showing)
+    {
+        // Start from nothing rather than from what was showing when the view closed.
+        clearTraces();
+        startTimerHz(frame_rate_hz_);
+    }
+    else
+    {
+        stopTimer();
+    }
+}
+
+void SpectrumView::timerCallback()
+{
+    const int n = feed_.pull(pulled_in_.data(), pulled_out_.data(), SpectrumFeed::capacity);
+    if (n == 0)
+    {
+        return;
+    }
+
+    // Slide the newest samples into the end of each history.
+    const int keep = std::max(0, fft_size_ - n);
+    const int fresh = std::min(n, fft_size_);
+    const std::pair<Trace *, const float *> traces[] = {{&input_, pulled_in_.data()},
+                                                         {&output_, pulled_out_.data()}};
+    for (const auto &[trace, pulled] : traces)
+    {
+        std::copy(trace->history.end() - keep, trace->history.end(), trace->history.begin());
+        std::copy(pulled + n - fresh, pulled + n, trace->history.begin() + keep);
+        analyze(*trace);
+    }
+    repaint();
+}
+
+void SpectrumView::clearTraces()
+{
+    for (Trace *t : {&input_, &output_})
+    {
+        t->history.assign(fft_size_, 0.f);
+        t->db.assign(num_bins_, min_db_);
+    }
+}
+
+void SpectrumView::analyze(Trace &trace)
+{
+    std::copy(trace.history.begin(), trace.history.end(), fft_data_.begin());
+    std::fill(fft_data_.begin() + fft_size_, fft_data_.end(), 0.f);
+    window_.multiplyWithWindowingTable(fft_data_.data(), static_cast<size_t>(fft_size_));
+    fft_.performFrequencyOnlyForwardTransform(fft_data_.data());
+
+    // A full-scale sine comes out at about fft_size / 4 with a Hann window.
+    const float norm = 4.f / static_cast<float>(fft_size_);
+    for (int i = 0; i < num_bins_; ++i)
+    {
+        const float db = juce::Decibels::gainToDecibels(fft_data_[i] * norm, min_db_);
+        trace.db[i] = std::max(db, trace.db[i] * smoothing_ + db * (1.f - smoothing_));
+    }
+}
+
+juce::Path SpectrumView::tracePath(const Trace &trace) const
+{
+    const auto area = getLocalBounds().toFloat();
+    const float nyquist = static_cast<float>(feed_.getSampleRate() / 2);
+    const float log_span = std::log(nyquist / min_hz_);
+    const float bin_hz = nyquist / num_bins_;
+
+    juce::Path p;
+    bool started = false;
+    for (int i = 1; i < num_bins_; ++i)
+    {
+        const float hz = bin_hz * i;
+        if (hz < min_hz_)
+        {
+            continue;
+        }
+        const float x = area.getX() + area.getWidth() * std::log(hz / min_hz_) / log_span;
+        const float y = juce::jmap(trace.db[i], min_db_, 0.f, area.getBottom(), area.getY());
+        if (!started)
+        {
+            p.startNewSubPath(x, y);
+            started = true;
+        }
+        else
+        {
+            p.lineTo(x, y);
+        }
+    }
+    return p;
+}
+
+void SpectrumView::paint(juce::Graphics &g)
+{
+    g.fillAll(background_col_);
+    if (feed_.getSampleRate() <= 0)
+    {
+        return;
+    }
+
+    // Decade lines.
+    const auto area = getLocalBounds().toFloat();
+    const float nyquist = static_cast<float>(feed_.getSampleRate() / 2);
+    const float log_span = std::log(nyquist / min_hz_);
+    g.setColour(grid_col_);
+    for (float hz : {100.f, 1000.f, 10000.f})
+    {
+        if (hz < nyquist)
+        {
+            const float x = area.getX() + area.getWidth() * std::log(hz / min_hz_) / log_span;
+            g.drawVerticalLine(juce::roundToInt(x), area.getY(), area.getBottom());
+        }
+    }
+
+    g.setColour(input_col_);
+    g.strokePath(tracePath(input_), juce::PathStrokeType(1.f));
+    g.setColour(output_col_);
+    g.strokePath(tracePath(output_), juce::PathStrokeType(1.5f));
+}
+
+} // namespace sapphire
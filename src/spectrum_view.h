@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "juce_dsp/juce_dsp.h"
+#include "juce_gui_basics/juce_gui_basics.h"
+#include "spectrum_feed.h"
+
+namespace sapphire
+{
+
+// Input and output spectra, computed from a SpectrumFeed on the message thread. The feed is only
+// active, and the FFT only runs, while the view is showing.
+class SpectrumView : public juce::Component, private juce::Timer
+{
+  public:
+    SpectrumView(SpectrumFeed &feed);
+    ~SpectrumView() override;
+
+    void paint(juce::Graphics &g) override;
+    void visibilityChanged() override;
+
+  private:
+    // 11.7 Hz bins at 48 kHz.
+    static constexpr int fft_order_ = 12;
+    static constexpr int fft_size_ = 1 << fft_order_;
+    static constexpr int num_bins_ = fft_size_ / 2;
+    static constexpr int frame_rate_hz_ = 30;
+    static constexpr float min_db_ = -90.f;
+    static constexpr float min_hz_ = 20.f;
+    // How much of the previous frame is kept, so the display doesn't flicker.
+    static constexpr float smoothing_ = 0.7f;
+    const juce::Colour background_col_ = juce::Colours::black.withAlpha(0.75f);
+    const juce::Colour grid_col_ = juce::Colours::white.withAlpha(0.15f);
+    const juce::Colour input_col_ = juce::Colours::lightgrey;
+    const juce::Colour output_col_ = juce::Colour(171, 157, 74);
+
+    // The samples waiting in history_ and the dB magnitudes shown for one signal.
+    struct Trace
+    {
+        std::vector<float> history;
+        std::vector<float> db;
+    };
+
+    void timerCallback() override;
+    void clearTraces();
+    void analyze(Trace &trace);
+    juce::Path tracePath(const Trace &trace) const;
+
+    SpectrumFeed &feed_;
+    juce::dsp::FFT fft_;
+    juce::dsp::WindowingFunction<float> window_;
+    std::vector<float> fft_data_;
+    std::vector<float> pulled_in_;
+    std::vector<float> pulled_out_;
+    Trace input_;
+    Trace output_;
+};
+
+} // namespace sapphire